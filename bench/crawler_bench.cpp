@@ -0,0 +1,252 @@
+// End-to-end crawler benchmark: starts synthetic_site, crawls it with the crawler and reports
+// pages/s, bytes/s, p50/p99 page latency and the crawler's peak RSS.
+//
+// Usage: crawler_bench [--port 18080] [--crawler <path>] [--site <path>] [--json <file>]
+//                      [--baseline <file> [--tolerance <percent>]] [site options...] [-- crawler options...]
+//
+// Options crawler_bench does not know (--fanout, --depth, --latency-ms, ...) are passed to
+// synthetic_site; everything after "--" is passed to the crawler. --json writes the results for
+// later comparison, and --baseline compares against such a file: the exit status is 2 if pages/s
+// dropped, or p99 latency or peak RSS grew, by more than --tolerance percent (default 10).
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifndef CRAWLER_PATH
+#define CRAWLER_PATH "./crawler"
+#endif
+#ifndef SYNTHETIC_SITE_PATH
+#define SYNTHETIC_SITE_PATH "./synthetic_site"
+#endif
+
+struct BenchResult {
+    double pages = 0;
+    double elapsed_seconds = 0;
+    double pages_per_second = 0;
+    double bytes_per_second = 0;
+    double latency_p50_ms = 0;
+    double latency_p99_ms = 0;
+    double errors = 0;
+    double peak_rss_mb = 0;
+};
+
+// Reads the number after "key": in a flat JSON document (the crawler's --stats-json, or our --json).
+static bool json_number(const std::string& text, const std::string& key, double& value) {
+    size_t at = text.find("\"" + key + "\":");
+    if (at == std::string::npos) return false;
+    value = std::strtod(text.c_str() + at + key.size() + 3, nullptr);
+    return true;
+}
+
+static std::string read_file(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+// Starts `argv[0]` with the given arguments; the child's stdout goes to /dev/null if `quiet`.
+static pid_t spawn(const std::vector<std::string>& args, bool quiet) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (quiet) {
+            int null_fd = open("/dev/null", O_WRONLY);
+            dup2(null_fd, STDOUT_FILENO);
+            close(null_fd);
+        }
+        std::vector<char*> argv;
+        for (const std::string& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+        argv.push_back(nullptr);
+        execv(argv[0], argv.data());
+        std::perror(argv[0]);
+        _exit(127);
+    }
+    return pid;
+}
+
+// Waits until something accepts connections on 127.0.0.1:port, or the server process exits.
+static bool wait_for_port(int port, pid_t server) {
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        int s = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bool connected = ::connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+        ::close(s);
+        if (connected) return true;
+        if (waitpid(server, nullptr, WNOHANG) == server) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return false;
+}
+
+static void write_result(const std::string& path, const BenchResult& r) {
+    std::ofstream out(path);
+    out << "{\n  \"pages\": " << r.pages
+        << ",\n  \"elapsed_seconds\": " << r.elapsed_seconds
+        << ",\n  \"pages_per_second\": " << r.pages_per_second
+        << ",\n  \"bytes_per_second\": " << r.bytes_per_second
+        << ",\n  \"latency_p50_ms\": " << r.latency_p50_ms
+        << ",\n  \"latency_p99_ms\": " << r.latency_p99_ms
+        << ",\n  \"errors\": " << r.errors
+        << ",\n  \"peak_rss_mb\": " << r.peak_rss_mb << "\n}\n";
+}
+
+// Percent change from `before` to `after`, signed so that positive is worse.
+static double regression(double before, double after, bool higher_is_better) {
+    if (before <= 0) return 0.0;
+    double change = 100.0 * (after - before) / before;
+    return higher_is_better ? -change : change;
+}
+
+int main(int argc, char* argv[]) {
+    std::string crawler_path = CRAWLER_PATH;
+    std::string site_path = SYNTHETIC_SITE_PATH;
+    std::string json_path;
+    std::string baseline_path;
+    double tolerance = 10.0;
+    int port = 18080;
+    std::vector<std::string> site_args;
+    std::vector<std::string> crawler_args;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--") {
+            crawler_args.assign(argv + i + 1, argv + argc);
+            break;
+        } else if (arg == "--crawler" && i + 1 < argc) {
+            crawler_path = argv[++i];
+        } else if (arg == "--site" && i + 1 < argc) {
+            site_path = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (arg == "--baseline" && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (arg == "--tolerance" && i + 1 < argc) {
+            tolerance = std::atof(argv[++i]);
+        } else if (arg == "--port" && i + 1 < argc) {
+            port = std::atoi(argv[++i]);
+        } else if (arg.rfind("--", 0) == 0 && i + 1 < argc) {
+            site_args.push_back(arg);
+            site_args.push_back(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--port <n>] [--crawler <path>] [--site <path>] [--json <file>]"
+                      << " [--baseline <file> [--tolerance <percent>]] [site options...] [-- crawler options...]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    // --- Start the site ---
+    std::vector<std::string> site_command = {site_path, "--port", std::to_string(port)};
+    site_command.insert(site_command.end(), site_args.begin(), site_args.end());
+    pid_t site = spawn(site_command, false);
+    if (site < 0 || !wait_for_port(port, site)) {
+        std::cerr << "synthetic_site did not start on port " << port << std::endl;
+        if (site > 0) kill(site, SIGTERM);
+        return 1;
+    }
+
+    // --- Crawl it ---
+    char stats_path[] = "/tmp/crawler_bench_XXXXXX";
+    int stats_fd = mkstemp(stats_path);
+    if (stats_fd < 0) {
+        std::perror("mkstemp");
+        kill(site, SIGTERM);
+        return 1;
+    }
+    close(stats_fd);
+    std::vector<std::string> crawl_command = {crawler_path, "--stats-json", stats_path, "--log-level", "error"};
+    crawl_command.insert(crawl_command.end(), crawler_args.begin(), crawler_args.end());
+    crawl_command.push_back("http://127.0.0.1:" + std::to_string(port) + "/p/0"); // The root page (page 0)
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t crawler = spawn(crawl_command, true);
+    int status = 0;
+    rusage usage{};
+    wait4(crawler, &status, 0, &usage);
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    kill(site, SIGTERM);
+    waitpid(site, nullptr, 0);
+
+    std::string stats = read_file(stats_path);
+    std::remove(stats_path);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || stats.empty()) {
+        std::cerr << "Crawler failed (status " << status << ")" << std::endl;
+        return 1;
+    }
+
+    BenchResult result;
+    json_number(stats, "pages", result.pages);
+    json_number(stats, "elapsed_seconds", result.elapsed_seconds);
+    json_number(stats, "pages_per_second", result.pages_per_second);
+    json_number(stats, "bytes_per_second", result.bytes_per_second);
+    json_number(stats, "latency_p50_ms", result.latency_p50_ms);
+    json_number(stats, "latency_p99_ms", result.latency_p99_ms);
+    json_number(stats, "errors", result.errors);
+#ifdef __APPLE__
+    result.peak_rss_mb = usage.ru_maxrss / (1024.0 * 1024.0); // Bytes on macOS
+#else
+    result.peak_rss_mb = usage.ru_maxrss / 1024.0;            // Kilobytes on Linux
+#endif
+
+    std::printf("--- Crawler Benchmark ---\n");
+    std::printf("  pages           %12.0f\n", result.pages);
+    std::printf("  crawl time      %12.2f s (%.2f s wall, including shutdown)\n", result.elapsed_seconds, wall);
+    std::printf("  pages/s         %12.1f\n", result.pages_per_second);
+    std::printf("  MB/s            %12.2f\n", result.bytes_per_second / (1024.0 * 1024.0));
+    std::printf("  latency p50     %12.2f ms\n", result.latency_p50_ms);
+    std::printf("  latency p99     %12.2f ms\n", result.latency_p99_ms);
+    std::printf("  fetch errors    %12.0f\n", result.errors);
+    std::printf("  peak RSS        %12.1f MB\n", result.peak_rss_mb);
+
+    if (!json_path.empty()) {
+        write_result(json_path, result);
+    }
+
+    // --- Compare with a baseline run ---
+    if (!baseline_path.empty()) {
+        std::string baseline = read_file(baseline_path);
+        BenchResult before;
+        if (!json_number(baseline, "pages_per_second", before.pages_per_second)) {
+            std::cerr << "Cannot read baseline " << baseline_path << std::endl;
+            return 1;
+        }
+        json_number(baseline, "latency_p99_ms", before.latency_p99_ms);
+        json_number(baseline, "peak_rss_mb", before.peak_rss_mb);
+        struct Check { const char* name; double change; double worse_by; };
+        Check checks[] = {
+            {"pages/s", -regression(before.pages_per_second, result.pages_per_second, true),
+             regression(before.pages_per_second, result.pages_per_second, true)},
+            {"latency p99", regression(before.latency_p99_ms, result.latency_p99_ms, false),
+             regression(before.latency_p99_ms, result.latency_p99_ms, false)},
+            {"peak RSS", regression(before.peak_rss_mb, result.peak_rss_mb, false),
+             regression(before.peak_rss_mb, result.peak_rss_mb, false)},
+        };
+        bool regressed = false;
+        std::printf("--- Against %s (tolerance %.1f%%) ---\n", baseline_path.c_str(), tolerance);
+        for (const Check& check : checks) {
+            bool failed = check.worse_by > tolerance;
+            regressed = regressed || failed;
+            std::printf("  %-15s %+11.1f%% %s\n", check.name, check.change, failed ? "REGRESSION" : "ok");
+        }
+        if (regressed) return 2;
+    }
+    return 0;
+}
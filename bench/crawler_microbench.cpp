@@ -0,0 +1,292 @@
+// Microbenchmarks (Google Benchmark) for the crawler's core data structures and parsers:
+//   * ThreadSafeQueue push/pop with N producers and M consumers
+//   * ThreadSafeSet insert, and lookups with a given hit rate, from 1-4 threads
+//   * resolve_url over a corpus of real-world href values (bench/data/hrefs.txt), into std::string
+//     and into an Arena
+//   * gumbo parse + destroy over saved HTML pages (bench/data/pages/*.html), through malloc and
+//     through a per-thread arena, from 1 thread and from 2-8 threads at once (allocator contention)
+//   * search_for_links over the same pages, with std::string links and with arena-backed links
+//
+// Results are also written as JSON (crawler_microbench.json unless --benchmark_out is given), which
+// Google Benchmark's tools/compare.py can diff against an earlier run. Build in Release.
+// The data directory can be overridden with the CRAWLER_BENCH_DATA environment variable.
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gumbo.h>
+
+#include "thread_safe_queue.hpp"
+#include "thread_safe_set.hpp"
+#include "link_extractor.hpp"
+#include "arena.hpp"
+#include "gumbo_arena.hpp"
+
+#ifndef BENCH_DATA_DIR
+#define BENCH_DATA_DIR "bench/data"
+#endif
+
+static std::filesystem::path data_dir() {
+    const char* overridden = std::getenv("CRAWLER_BENCH_DATA");
+    return overridden ? overridden : BENCH_DATA_DIR;
+}
+
+// Crawl-like URLs: a handful of hosts, paths of varying depth and some query strings.
+static std::string make_url(uint64_t i) {
+    static const char* const hosts[] = {"https://www.example.com", "https://en.example.org", "http://blog.example.net",
+                                        "https://shop.example.co.uk"};
+    std::string url = hosts[i % 4];
+    url += "/section-" + std::to_string(i % 97) + "/item/" + std::to_string(i);
+    if (i % 3 == 0) url += "?page=" + std::to_string(i % 50) + "&sort=recent";
+    return url;
+}
+
+// --- ThreadSafeQueue ---
+// Each iteration moves ITEMS URLs from `producers` threads to `consumers` threads through one queue.
+static void BM_QueueProducersConsumers(benchmark::State& state) {
+    const int producers = static_cast<int>(state.range(0));
+    const int consumers = static_cast<int>(state.range(1));
+    const int ITEMS = 100000;
+    std::vector<std::string> urls;
+    for (int i = 0; i < ITEMS; ++i) urls.push_back(make_url(i));
+
+    for (auto _ : state) {
+        ThreadSafeQueue<std::string> queue;
+        std::atomic<int> popped{0};
+        std::vector<std::thread> threads;
+        for (int c = 0; c < consumers; ++c) {
+            threads.emplace_back([&] {
+                while (std::optional<std::string> url = queue.pop()) {
+                    benchmark::DoNotOptimize(url->data());
+                    popped.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+        std::vector<std::thread> pushers;
+        for (int p = 0; p < producers; ++p) {
+            pushers.emplace_back([&, p] {
+                for (int i = p; i < ITEMS; i += producers) queue.push(urls[i]);
+            });
+        }
+        for (std::thread& t : pushers) t.join();
+        while (popped.load(std::memory_order_relaxed) < ITEMS) std::this_thread::yield();
+        queue.request_stop();
+        for (std::thread& t : threads) t.join();
+    }
+    state.SetItemsProcessed(state.iterations() * ITEMS);
+}
+BENCHMARK(BM_QueueProducersConsumers)
+    ->ArgNames({"producers", "consumers"})
+    ->Args({1, 1})->Args({1, 4})->Args({4, 1})->Args({2, 2})->Args({4, 4})->Args({8, 8})
+    ->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// --- ThreadSafeSet ---
+// Every thread inserts URLs no other thread inserts, so each insert grows the set.
+static void BM_SetInsert(benchmark::State& state) {
+    static ThreadSafeSet* set = nullptr;
+    if (state.thread_index() == 0) set = new ThreadSafeSet();
+    uint64_t next = static_cast<uint64_t>(state.thread_index());
+    std::vector<std::string> urls;
+    for (int i = 0; i < 4096; ++i) urls.push_back(make_url(next + static_cast<uint64_t>(i) * state.threads()));
+
+    uint64_t round = 0;
+    for (auto _ : state) {
+        std::string suffix = "&r=" + std::to_string(round++); // A new batch each round, so the set keeps growing
+        for (const std::string& url : urls) benchmark::DoNotOptimize(set->insert(url + suffix));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(urls.size()));
+    if (state.thread_index() == 0) {
+        delete set;
+        set = nullptr;
+    }
+}
+BENCHMARK(BM_SetInsert)->ThreadRange(1, 4)->UseRealTime();
+
+// Lookups against a set of 200K URLs; the argument is the percentage of lookups that hit.
+static void BM_SetLookup(benchmark::State& state) {
+    static ThreadSafeSet* set = [] {
+        auto* filled = new ThreadSafeSet();
+        for (uint64_t i = 0; i < 200000; ++i) filled->insert(make_url(i));
+        return filled;
+    }();
+    const int hit_percent = static_cast<int>(state.range(0));
+    std::mt19937_64 rng(12345 + state.thread_index());
+    std::vector<std::string> probes;
+    for (int i = 0; i < 8192; ++i) {
+        bool hit = static_cast<int>(rng() % 100) < hit_percent;
+        probes.push_back(make_url(hit ? rng() % 200000 : 200000 + rng() % 1000000));
+    }
+    for (auto _ : state) {
+        for (const std::string& url : probes) benchmark::DoNotOptimize(set->contains(url));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(probes.size()));
+}
+BENCHMARK(BM_SetLookup)->ArgName("hit%")->Arg(0)->Arg(50)->Arg(90)->Arg(100)->ThreadRange(1, 4)->UseRealTime();
+
+// --- resolve_url ---
+static const std::vector<std::string>& href_corpus() {
+    static const std::vector<std::string> hrefs = [] {
+        std::vector<std::string> lines;
+        std::ifstream in(data_dir() / "hrefs.txt");
+        for (std::string line; std::getline(in, line); ) {
+            if (!line.empty() && line[0] != '#') lines.push_back(line);
+        }
+        return lines;
+    }();
+    return hrefs;
+}
+
+static void BM_ResolveUrl(benchmark::State& state) {
+    static const char* const bases[] = {"https://www.example.com/news/2024/01/15/article.html", "https://example.org",
+                                        "http://blog.example.net/posts/", "https://shop.example.co.uk/c/cables?page=2"};
+    const std::vector<std::string>& hrefs = href_corpus();
+    if (hrefs.empty()) {
+        state.SkipWithError("no hrefs.txt in the data directory");
+        return;
+    }
+    for (auto _ : state) {
+        for (const char* base : bases) {
+            std::string base_url = base;
+            for (const std::string& href : hrefs) benchmark::DoNotOptimize(resolve_url(base_url, href));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(hrefs.size() * 4));
+}
+BENCHMARK(BM_ResolveUrl);
+
+// The worker's variant: URLs built in an arena that is reset once per corpus pass (per page, in the crawl).
+static void BM_ResolveUrlArena(benchmark::State& state) {
+    static const char* const bases[] = {"https://www.example.com/news/2024/01/15/article.html", "https://example.org",
+                                        "http://blog.example.net/posts/", "https://shop.example.co.uk/c/cables?page=2"};
+    const std::vector<std::string>& hrefs = href_corpus();
+    if (hrefs.empty()) {
+        state.SkipWithError("no hrefs.txt in the data directory");
+        return;
+    }
+    Arena arena;
+    for (auto _ : state) {
+        for (const char* base : bases) {
+            arena.reset();
+            for (const std::string& href : hrefs) benchmark::DoNotOptimize(resolve_url(arena, base, href).data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(hrefs.size() * 4));
+}
+BENCHMARK(BM_ResolveUrlArena);
+
+// --- Link extraction, one benchmark pair per saved page ---
+static void BM_GumboParse(benchmark::State& state, const std::string& html) {
+    for (auto _ : state) {
+        GumboOutput* output = gumbo_parse_with_options(&kGumboDefaultOptions, html.data(), html.size());
+        benchmark::DoNotOptimize(output);
+        gumbo_destroy_output(&kGumboDefaultOptions, output);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(html.size()));
+}
+
+// The worker's variant: the tree comes out of this thread's arena and is dropped by one reset().
+static void BM_GumboParseArena(benchmark::State& state, const std::string& html) {
+    Arena arena(256 * 1024);
+    const GumboOptions options = gumbo_arena_options(arena);
+    for (auto _ : state) {
+        GumboOutput* output = gumbo_parse_with_options(&options, html.data(), html.size());
+        benchmark::DoNotOptimize(output);
+        arena.reset();
+    }
+    state.counters["arena_kb"] = benchmark::Counter(static_cast<double>(arena.bytes_reserved()) / 1024, benchmark::Counter::kAvgThreads);
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(html.size()));
+}
+
+// What the worker does after parsing: find <base href>, then collect and resolve every <a href>.
+static void BM_SearchForLinks(benchmark::State& state, const std::string& html) {
+    GumboOutput* output = gumbo_parse_with_options(&kGumboDefaultOptions, html.data(), html.size());
+    const std::string page_url = "https://www.example.com/dir/page.html";
+    size_t found = 0;
+    for (auto _ : state) {
+        std::vector<std::string> links;
+        std::string base_href = find_base_href(output->root);
+        search_for_links(output->root, links, base_href.empty() ? page_url : resolve_url(page_url, base_href));
+        found = links.size();
+        benchmark::DoNotOptimize(links.data());
+    }
+    gumbo_destroy_output(&kGumboDefaultOptions, output);
+    state.counters["links"] = static_cast<double>(found);
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(found));
+}
+
+// The same with the worker's per-thread arena and reused link vector.
+static void BM_SearchForLinksArena(benchmark::State& state, const std::string& html) {
+    GumboOutput* output = gumbo_parse_with_options(&kGumboDefaultOptions, html.data(), html.size());
+    const std::string page_url = "https://www.example.com/dir/page.html";
+    Arena arena;
+    std::vector<std::string_view> links;
+    size_t found = 0;
+    for (auto _ : state) {
+        links.clear();
+        arena.reset();
+        std::string base_href = find_base_href(output->root);
+        search_for_links(output->root, arena, links, base_href.empty() ? page_url : resolve_url(page_url, base_href));
+        found = links.size();
+        benchmark::DoNotOptimize(links.data());
+    }
+    gumbo_destroy_output(&kGumboDefaultOptions, output);
+    state.counters["links"] = static_cast<double>(found);
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(found));
+}
+
+static void register_page_benchmarks() {
+    std::vector<std::filesystem::path> pages;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(data_dir() / "pages", ec)) {
+        if (entry.path().extension() == ".html") pages.push_back(entry.path());
+    }
+    std::sort(pages.begin(), pages.end());
+    for (const std::filesystem::path& page : pages) {
+        std::ifstream in(page, std::ios::binary);
+        std::stringstream text;
+        text << in.rdbuf();
+        std::string html = text.str();
+        std::string name = page.stem().string();
+        benchmark::RegisterBenchmark(("BM_GumboParse/" + name).c_str(), BM_GumboParse, html);
+        benchmark::RegisterBenchmark(("BM_GumboParseArena/" + name).c_str(), BM_GumboParseArena, html);
+        // Several workers parsing at once: every thread goes through malloc, or each through its own arena
+        benchmark::RegisterBenchmark(("BM_GumboParseThreads/" + name).c_str(), BM_GumboParse, html)
+            ->ThreadRange(2, 8)->UseRealTime();
+        benchmark::RegisterBenchmark(("BM_GumboParseArenaThreads/" + name).c_str(), BM_GumboParseArena, html)
+            ->ThreadRange(2, 8)->UseRealTime();
+        benchmark::RegisterBenchmark(("BM_SearchForLinks/" + name).c_str(), BM_SearchForLinks, html);
+        benchmark::RegisterBenchmark(("BM_SearchForLinksArena/" + name).c_str(), BM_SearchForLinksArena, html);
+    }
+}
+
+int main(int argc, char** argv) {
+    register_page_benchmarks();
+
+    // Default to also writing JSON next to the console table
+    std::vector<char*> args(argv, argv + argc);
+    bool has_out = std::any_of(args.begin(), args.end(), [](const char* arg) {
+        return std::string(arg).rfind("--benchmark_out=", 0) == 0;
+    });
+    std::string out_flag = "--benchmark_out=crawler_microbench.json";
+    std::string format_flag = "--benchmark_out_format=json";
+    if (!has_out) {
+        args.push_back(out_flag.data());
+        args.push_back(format_flag.data());
+    }
+    int args_count = static_cast<int>(args.size());
+
+    benchmark::Initialize(&args_count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(args_count, args.data())) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
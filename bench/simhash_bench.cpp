@@ -0,0 +1,120 @@
+// Benchmark for the SimHash shingle/hash kernel and the banded near-duplicate index.
+// Usage: simhash_bench [pages] [words-per-page]
+#include <iostream>
+#include <string>
+#include <vector>
+#include <array>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+
+#include "simhash.hpp"
+
+// The obvious per-bit version of the kernel, for comparison with simhash_detail::accumulate_bits.
+static void accumulate_bits_branchy(const uint64_t* hashes, size_t count, std::array<int32_t, 64>& votes) {
+    for (size_t i = 0; i < count; ++i) {
+        for (int b = 0; b < 64; ++b) {
+            if (hashes[i] & (uint64_t(1) << b)) {
+                votes[b]++;
+            } else {
+                votes[b]--;
+            }
+        }
+    }
+}
+
+template <typename F>
+static double time_seconds(F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    size_t pages = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+    size_t words_per_page = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000;
+
+    // Build a deterministic corpus: random words from a fixed vocabulary
+    std::mt19937_64 rng(42);
+    std::vector<std::string> vocabulary;
+    for (int i = 0; i < 5000; ++i) {
+        std::string w;
+        size_t len = 3 + rng() % 8;
+        for (size_t j = 0; j < len; ++j) {
+            w.push_back(static_cast<char>('a' + rng() % 26));
+        }
+        vocabulary.push_back(w);
+    }
+    std::vector<std::string> corpus(pages);
+    size_t total_bytes = 0;
+    for (std::string& page : corpus) {
+        for (size_t w = 0; w < words_per_page; ++w) {
+            page += vocabulary[rng() % vocabulary.size()];
+            page += ' ';
+        }
+        total_bytes += page.size();
+    }
+
+    // 1. Word hashing + shingling (the part that touches the text)
+    std::vector<std::vector<uint64_t>> shingles(pages);
+    double t_shingle = time_seconds([&] {
+        std::vector<uint64_t> words;
+        for (size_t i = 0; i < pages; ++i) {
+            words.clear();
+            simhash_detail::hash_words(corpus[i], words);
+            simhash_detail::hash_shingles(words, shingles[i]);
+        }
+    });
+
+    // 2. The bit-accumulation kernel, vectorizable vs branchy reference
+    size_t total_shingles = 0;
+    uint64_t sink = 0;
+    const int repeats = 10;
+    double t_kernel = time_seconds([&] {
+        for (int r = 0; r < repeats; ++r) {
+            for (const auto& s : shingles) {
+                std::array<uint32_t, 64> ones{};
+                simhash_detail::accumulate_bits(s.data(), s.size(), ones);
+                sink += simhash_detail::fingerprint_from_counts(ones, s.size());
+                total_shingles += s.size();
+            }
+        }
+    });
+    double t_branchy = time_seconds([&] {
+        for (int r = 0; r < repeats; ++r) {
+            for (const auto& s : shingles) {
+                std::array<int32_t, 64> votes{};
+                accumulate_bits_branchy(s.data(), s.size(), votes);
+                sink += static_cast<uint64_t>(votes[0]);
+            }
+        }
+    });
+
+    // 3. Banded index: insert every page, then query slightly perturbed copies
+    std::vector<uint64_t> fingerprints;
+    for (const auto& s : shingles) {
+        fingerprints.push_back(simhash_of_shingles(s));
+    }
+    SimHashIndex index;
+    double t_insert = time_seconds([&] {
+        for (uint64_t fp : fingerprints) {
+            sink += index.find_or_insert(fp);
+        }
+    });
+    size_t hits = 0;
+    double t_query = time_seconds([&] {
+        for (uint64_t fp : fingerprints) {
+            hits += index.find_or_insert(fp ^ (uint64_t(1) << (fp % 64))); // One bit away: must hit
+        }
+    });
+
+    std::cout << "Pages: " << pages << ", words/page: " << words_per_page
+              << ", text: " << total_bytes / (1024.0 * 1024.0) << " MB" << std::endl;
+    std::cout << "Word hash + shingle:   " << total_bytes / t_shingle / (1024.0 * 1024.0) << " MB/s" << std::endl;
+    std::cout << "Bit kernel:            " << total_shingles / t_kernel / 1e6 << " M shingles/s" << std::endl;
+    std::cout << "Bit kernel (branchy):  " << total_shingles / t_branchy / 1e6 << " M shingles/s" << std::endl;
+    std::cout << "Index insert:          " << pages / t_insert / 1e6 << " M ops/s" << std::endl;
+    std::cout << "Index query:           " << pages / t_query / 1e6 << " M ops/s ("
+              << hits << "/" << pages << " near-duplicates found)" << std::endl;
+    return sink == 42 ? 1 : 0; // Keep the optimizer from discarding the work
+}
@@ -0,0 +1,221 @@
+// Local HTTP server for a generated website, so crawler throughput can be measured offline and
+// reproducibly (see crawler_bench).
+//
+// The site is a tree: page 0 (also served at "/") links to `fanout` children, each of those to
+// `fanout` more, down to `depth` levels. Every page also links back to its parent and to two
+// pseudo-random pages elsewhere in the tree. Pages are numbered (/p/1234, see page_names.hpp) like
+// a real catalogue, which the crawler's trap detector leaves uncapped.
+//
+// All choices are derived from --seed and the page ID, so every run serves the same site:
+//   * page sizes follow a log-normal distribution around --page-kb
+//   * --error-rate of the pages answer 500
+//   * --redirect-rate of the links point at /r/<name>, which answers 301 to /p/<name>
+//   * every response waits --latency-ms plus up to --jitter-ms (this one is random per request)
+//
+// Usage: synthetic_site [--port 18080] [--fanout 10] [--depth 4] [--page-kb 16] [--page-kb-sigma 0.6]
+//                       [--latency-ms 0] [--jitter-ms 0] [--error-rate 0] [--redirect-rate 0] [--seed 1]
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include "page_names.hpp"
+
+struct SiteOptions {
+    int port = 18080;
+    uint64_t fanout = 10;
+    int depth = 4;
+    double page_kb = 16.0;
+    double page_kb_sigma = 0.6;
+    int latency_ms = 0;
+    int jitter_ms = 0;
+    double error_rate = 0.0;
+    double redirect_rate = 0.0;
+    uint64_t seed = 1;
+};
+
+static SiteOptions options;
+static uint64_t page_count = 0;
+
+// SplitMix64: a cheap, well-mixed hash for deriving per-page decisions from (seed, page, salt).
+static uint64_t mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static double unit(uint64_t page, uint64_t salt) {
+    return (mix(options.seed ^ mix(page * 0x100000001B3ULL + salt)) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// A page of the tree named by `name` (page_names.hpp).
+static bool parse_page(const std::string& name, uint64_t& id) {
+    return parse_page_name(name, id) && id < page_count;
+}
+
+static std::string link_to(uint64_t from, uint64_t to, uint64_t salt) {
+    bool redirect = unit(from, 1000 + salt) < options.redirect_rate;
+    return std::string("<a href=\"/") + (redirect ? "r/" : "p/") + page_name(to) + "\">" + page_name(to) + "</a>\n";
+}
+
+static std::string render_page(uint64_t id) {
+    std::string html = "<!DOCTYPE html><html><head><title>Page " + page_name(id) + "</title></head><body>\n";
+    html += "<h1>Page " + page_name(id) + "</h1>\n<nav>\n";
+    uint64_t salt = 0;
+    for (uint64_t k = 1; k <= options.fanout; ++k) {
+        uint64_t child = id * options.fanout + k;
+        if (child < page_count) html += link_to(id, child, salt++);
+    }
+    if (id > 0) html += link_to(id, (id - 1) / options.fanout, salt++);
+    for (int k = 0; k < 2; ++k) {
+        html += link_to(id, static_cast<uint64_t>(unit(id, 2000 + k) * page_count), salt++);
+    }
+    html += "</nav>\n<p>\n";
+
+    // Filler text of pseudo-random words, different on every page (so no page is a near-duplicate)
+    double z = std::sqrt(-2.0 * std::log(std::max(unit(id, 1), 1e-12))) * std::cos(2 * M_PI * unit(id, 2));
+    size_t target = static_cast<size_t>(options.page_kb * 1024 * std::exp(options.page_kb_sigma * z));
+    std::mt19937_64 words(mix(options.seed ^ id));
+    while (html.size() < target) {
+        size_t length = 2 + words() % 9;
+        for (size_t i = 0; i < length; ++i) html.push_back(static_cast<char>('a' + words() % 26));
+        html.push_back(words() % 12 == 0 ? '\n' : ' ');
+    }
+    html += "\n</p></body></html>\n";
+    return html;
+}
+
+static std::string response(int code, const char* reason, const std::string& extra_headers,
+                            const std::string& content_type, const std::string& body, bool keep_alive) {
+    return "HTTP/1.1 " + std::to_string(code) + " " + reason + "\r\n" + extra_headers +
+           "Content-Type: " + content_type + "\r\n"
+           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+           "Connection: " + (keep_alive ? "keep-alive" : "close") + "\r\n\r\n" + body;
+}
+
+static std::string handle(const std::string& path, bool keep_alive) {
+    uint64_t id = 0;
+    std::string target = path == "/" ? "/p/" + page_name(0) : path;
+    if (target.rfind("/r/", 0) == 0 && parse_page(target.substr(3), id)) {
+        return response(301, "Moved Permanently", "Location: /p/" + page_name(id) + "\r\n", "text/html", "", keep_alive);
+    }
+    if (target.rfind("/p/", 0) == 0 && parse_page(target.substr(3), id)) {
+        if (unit(id, 3) < options.error_rate) {
+            return response(500, "Internal Server Error", "", "text/plain", "error\n", keep_alive);
+        }
+        return response(200, "OK", "", "text/html; charset=utf-8", render_page(id), keep_alive);
+    }
+    return response(404, "Not Found", "", "text/plain", "not found\n", keep_alive);
+}
+
+// Serves one keep-alive connection until the client closes it.
+static void serve_connection(int client) {
+    std::mt19937 jitter(static_cast<unsigned>(client) ^ static_cast<unsigned>(std::random_device{}()));
+    std::string buffer;
+    char chunk[4096];
+    while (true) {
+        size_t end;
+        while ((end = buffer.find("\r\n\r\n")) == std::string::npos) {
+            ssize_t n = ::recv(client, chunk, sizeof(chunk), 0);
+            if (n <= 0) {
+                ::close(client);
+                return;
+            }
+            buffer.append(chunk, static_cast<size_t>(n));
+        }
+        std::string head = buffer.substr(0, end);
+        buffer.erase(0, end + 4); // Requests from the crawler have no body
+
+        size_t path_start = head.find(' ') + 1;
+        std::string path = head.substr(path_start, head.find(' ', path_start) - path_start);
+        bool keep_alive = head.find("HTTP/1.1") != std::string::npos && head.find("Connection: close") == std::string::npos;
+
+        int delay = options.latency_ms + (options.jitter_ms > 0 ? static_cast<int>(jitter() % (options.jitter_ms + 1)) : 0);
+        if (delay > 0) std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+
+        std::string out = handle(path, keep_alive);
+        size_t sent = 0;
+        while (sent < out.size()) {
+            ssize_t n = ::send(client, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                ::close(client);
+                return;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        if (!keep_alive) {
+            ::close(client);
+            return;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        const char* value = argv[i + 1];
+        if (arg == "--port") options.port = std::atoi(value);
+        else if (arg == "--fanout") options.fanout = std::strtoull(value, nullptr, 10);
+        else if (arg == "--depth") options.depth = std::atoi(value);
+        else if (arg == "--page-kb") options.page_kb = std::atof(value);
+        else if (arg == "--page-kb-sigma") options.page_kb_sigma = std::atof(value);
+        else if (arg == "--latency-ms") options.latency_ms = std::atoi(value);
+        else if (arg == "--jitter-ms") options.jitter_ms = std::atoi(value);
+        else if (arg == "--error-rate") options.error_rate = std::atof(value);
+        else if (arg == "--redirect-rate") options.redirect_rate = std::atof(value);
+        else if (arg == "--seed") options.seed = std::strtoull(value, nullptr, 10);
+        else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+    if (options.fanout < 1) options.fanout = 1;
+
+    // Pages in a full tree of the given fan-out and depth
+    uint64_t level = 1;
+    for (int d = 0; d <= options.depth; ++d) {
+        page_count += level;
+        level *= options.fanout;
+    }
+
+    std::signal(SIGPIPE, SIG_IGN);
+    int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0) {
+        std::cerr << "Cannot create a socket: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    int yes = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(options.port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(listener, 128) != 0) {
+        std::cerr << "Cannot listen on port " << options.port << ": " << std::strerror(errno) << std::endl;
+        ::close(listener);
+        return 1;
+    }
+    std::cout << "Serving " << page_count << " pages on http://127.0.0.1:" << options.port << "/" << std::endl;
+
+    while (true) {
+        int client = ::accept(listener, nullptr, nullptr);
+        if (client < 0) continue;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        std::thread(serve_connection, client).detach(); // The crawler keeps a handful of connections open
+    }
+}
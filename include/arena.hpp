@@ -0,0 +1,105 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <memory>
+#include <vector>
+#include <string_view>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <cstdint>
+
+// Bump allocator for memory that dies all at once: everything a worker builds while handling one
+// page (the gumbo tree, resolved links) is carved out of a few large blocks and released by reset().
+//
+// There is no per-allocation free. reset() keeps the blocks for the next page; if a page needed
+// more than one block they are merged into a single block of the combined size, so after the first
+// few pages a worker's arena stops calling malloc altogether. An outsized page should not pin its
+// memory for the rest of the crawl, though: above `retain_limit` bytes, reset() frees the blocks.
+// One arena per thread: it has no lock.
+class Arena {
+public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    explicit Arena(size_t block_size = DEFAULT_BLOCK_SIZE, size_t retain_limit = SIZE_MAX)
+        : block_size(block_size), retain_limit(retain_limit) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // `size` bytes aligned to `align` (a power of two), valid until the next reset().
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        uintptr_t aligned = (reinterpret_cast<uintptr_t>(cursor) + (align - 1)) & ~static_cast<uintptr_t>(align - 1);
+        if (cursor == nullptr || aligned + size > reinterpret_cast<uintptr_t>(end)) {
+            grow(size + align);
+            aligned = (reinterpret_cast<uintptr_t>(cursor) + (align - 1)) & ~static_cast<uintptr_t>(align - 1);
+        }
+        cursor = reinterpret_cast<char*>(aligned + size);
+        used += size;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    char* allocate_chars(size_t size) { return static_cast<char*>(allocate(size, 1)); }
+
+    // A copy of `text` that lives in the arena.
+    std::string_view copy(std::string_view text) {
+        char* out = allocate_chars(text.size());
+        if (!text.empty()) std::memcpy(out, text.data(), text.size());
+        return {out, text.size()};
+    }
+
+    // Releases everything allocated since the last reset().
+    void reset() {
+        size_t total = bytes_reserved();
+        if (total > retain_limit) {
+            blocks.clear(); // Start over with one block_size block on the next allocation
+        } else if (blocks.size() > 1) {
+            blocks.clear();
+            blocks.push_back(Block{std::make_unique<char[]>(total), total});
+        }
+        current = 0;
+        cursor = blocks.empty() ? nullptr : blocks[0].data.get();
+        end = blocks.empty() ? nullptr : cursor + blocks[0].size;
+        used = 0;
+    }
+
+    size_t bytes_used() const { return used; }     // Handed out since the last reset()
+    size_t bytes_reserved() const {                // Held in blocks
+        size_t total = 0;
+        for (const Block& block : blocks) total += block.size;
+        return total;
+    }
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    // Moves on to the next block with room for `needed` bytes, allocating one if there is none.
+    void grow(size_t needed) {
+        while (current + 1 < blocks.size()) {
+            ++current;
+            if (blocks[current].size >= needed) {
+                cursor = blocks[current].data.get();
+                end = cursor + blocks[current].size;
+                return;
+            }
+        }
+        size_t size = std::max(block_size, needed);
+        blocks.push_back(Block{std::make_unique<char[]>(size), size});
+        current = blocks.size() - 1;
+        cursor = blocks[current].data.get();
+        end = cursor + size;
+    }
+
+    const size_t block_size;
+    const size_t retain_limit;
+    std::vector<Block> blocks;
+    size_t current = 0;      // Block being carved
+    char* cursor = nullptr;  // Next free byte in it
+    char* end = nullptr;
+    size_t used = 0;
+};
+
+#endif // ARENA_HPP
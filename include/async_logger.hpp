@@ -0,0 +1,301 @@
+#ifndef ASYNC_LOGGER_HPP
+#define ASYNC_LOGGER_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <utility>
+#include <algorithm>
+#include <initializer_list>
+
+enum class LogLevel : uint8_t { Debug, Info, Warn, Error, Off };
+
+inline const char* log_level_name(LogLevel level) {
+    static const char* const names[] = {"debug", "info", "warn", "error", "off"};
+    return names[static_cast<size_t>(level)];
+}
+
+// Structured logger that never blocks the calling thread.
+//
+// Each thread formats its message (a JSON object body) into a fixed-size slot of its own
+// single-producer / single-consumer ring, and a drain thread writes the slots out as NDJSON, one
+// object per line. When a ring is full the message is dropped and counted instead of waiting, and a
+// per-thread token bucket caps how many messages a thread may log per second, so an error storm
+// costs each worker a few hundred formatted messages per second at most. Dropped and rate-limited
+// messages are reported in the next line that thread gets through ("dropped" / "suppressed").
+class AsyncLogger {
+public:
+    using Field = std::pair<const char*, std::string_view>;
+
+    static constexpr size_t SLOT_BYTES = 512;
+    static constexpr size_t RING_SLOTS = 256; // Per thread; a power of two
+
+    AsyncLogger() : epoch(std::chrono::steady_clock::now()) {}
+
+    ~AsyncLogger() {
+        stop();
+    }
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    // Starts the drain thread, writing to `out` (stderr unless a file is given).
+    // `rate_per_second` is each thread's budget of messages per second (bursts up to the same amount).
+    void start(std::FILE* out, LogLevel level, double rate_per_second = 100.0) {
+        sink = out;
+        min_level.store(level, std::memory_order_relaxed);
+        rate = rate_per_second;
+        running = true;
+        drainer = std::thread(&AsyncLogger::drain_loop, this);
+    }
+
+    // Writes whatever is still buffered and stops the drain thread.
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            if (!running) return;
+            running = false;
+        }
+        cond.notify_all();
+        drainer.join();
+        std::fflush(sink);
+    }
+
+    // Names the calling thread in its log lines; call before the thread logs anything.
+    // Threads that never call this get "thread N".
+    void register_thread(const std::string& name) {
+        ring_for_this_thread().name = name;
+    }
+
+    // Hands the calling thread's ring back for the next thread that registers, so a pool that keeps
+    // replacing threads does not keep adding rings. Call last thing before the thread exits; what it
+    // logged is still written out.
+    void release_thread() {
+        Ring*& ring = this_thread_ring();
+        if (!ring || this_thread_owner() != this) return;
+        std::lock_guard<std::mutex> lock(mut);
+        free_rings.push_back(ring);
+        ring = nullptr;
+    }
+
+    bool enabled(LogLevel level) const {
+        return level >= min_level.load(std::memory_order_relaxed);
+    }
+
+    // Logs an event with string fields: {"event":"fetch_failed","url":"...","error":"..."}.
+    void log(LogLevel level, const char* event, std::initializer_list<Field> fields = {}) {
+        if (!enabled(level)) return;
+        Ring& ring = ring_for_this_thread();
+
+        // Token bucket: refill by elapsed time, spend one token per message
+        double now = seconds_since_epoch();
+        ring.tokens = std::min(rate, ring.tokens + (now - ring.last_refill) * rate);
+        ring.last_refill = now;
+        if (ring.tokens < 1.0) {
+            ring.suppressed++;
+            return;
+        }
+        ring.tokens -= 1.0;
+
+        uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+        if (tail - ring.head.load(std::memory_order_acquire) >= RING_SLOTS) {
+            ring.dropped++; // Drain thread is behind: drop rather than wait
+            return;
+        }
+        Slot& slot = ring.slots[tail & (RING_SLOTS - 1)];
+        slot.time = std::chrono::system_clock::now();
+        slot.level = level;
+
+        Writer w{slot.text, 0};
+        w.field("event", event);
+        for (const Field& field : fields) {
+            w.field(field.first, field.second.data(), field.second.size());
+        }
+        if (ring.suppressed > 0) {
+            w.field("suppressed", std::to_string(ring.suppressed).c_str());
+            ring.suppressed = 0;
+        }
+        if (ring.dropped > 0) {
+            w.field("dropped", std::to_string(ring.dropped).c_str());
+            ring.dropped = 0;
+        }
+        slot.length = w.length;
+        ring.tail.store(tail + 1, std::memory_order_release);
+    }
+
+private:
+    struct Slot {
+        std::chrono::system_clock::time_point time;
+        LogLevel level;
+        size_t length;
+        char text[SLOT_BYTES]; // "key":"value" pairs, already JSON-escaped
+    };
+
+    struct Ring {
+        std::string name;
+        std::vector<Slot> slots = std::vector<Slot>(RING_SLOTS);
+        std::atomic<uint64_t> head{0}; // Advanced by the drain thread
+        std::atomic<uint64_t> tail{0}; // Advanced by the owning thread
+        // Owning thread only:
+        double tokens = 0.0;
+        double last_refill = 0.0;
+        uint64_t suppressed = 0;
+        uint64_t dropped = 0;
+    };
+
+    // Appends "key":"value" pairs to a slot, escaping as it goes and never splitting an escape:
+    // a value that does not fit is cut short, and the closing quote always fits.
+    struct Writer {
+        char* out;
+        size_t length;
+
+        void field(const char* key, const char* value) { field(key, value, std::strlen(value)); }
+
+        void field(const char* key, const char* value, size_t size) {
+            size_t key_size = std::strlen(key);
+            if (length + key_size + 8 > SLOT_BYTES) return;
+            if (length > 0) out[length++] = ',';
+            out[length++] = '"';
+            std::memcpy(out + length, key, key_size);
+            length += key_size;
+            std::memcpy(out + length, "\":\"", 3);
+            length += 3;
+            for (size_t i = 0; i < size; ++i) {
+                char escaped[8];
+                size_t n = escape(static_cast<unsigned char>(value[i]), escaped);
+                if (length + n + 1 > SLOT_BYTES) break;
+                std::memcpy(out + length, escaped, n);
+                length += n;
+            }
+            out[length++] = '"';
+        }
+
+        static size_t escape(unsigned char c, char* escaped) {
+            if (c == '"' || c == '\\') {
+                escaped[0] = '\\';
+                escaped[1] = static_cast<char>(c);
+                return 2;
+            }
+            if (c < 0x20) {
+                return static_cast<size_t>(std::snprintf(escaped, 8, "\\u%04x", c));
+            }
+            escaped[0] = static_cast<char>(c);
+            return 1;
+        }
+    };
+
+    static Ring*& this_thread_ring() {
+        thread_local Ring* ring = nullptr;
+        return ring;
+    }
+
+    static const AsyncLogger*& this_thread_owner() {
+        thread_local const AsyncLogger* owner = nullptr;
+        return owner;
+    }
+
+    Ring& ring_for_this_thread() {
+        Ring*& ring = this_thread_ring();
+        if (!ring || this_thread_owner() != this) {
+            std::lock_guard<std::mutex> lock(mut);
+            // A released ring is reused once the drain thread has written out all of it: until then
+            // it may still read the old name
+            auto drained = std::find_if(free_rings.begin(), free_rings.end(), [](const Ring* free_ring) {
+                return free_ring->head.load(std::memory_order_acquire) == free_ring->tail.load(std::memory_order_relaxed);
+            });
+            if (drained != free_rings.end()) {
+                ring = *drained;
+                free_rings.erase(drained);
+            } else {
+                rings.push_back(std::make_unique<Ring>());
+                ring = rings.back().get();
+            }
+            ring->name = "thread " + std::to_string(rings.size());
+            ring->tokens = rate;
+            ring->last_refill = seconds_since_epoch();
+            ring->suppressed = 0;
+            ring->dropped = 0;
+            this_thread_owner() = this;
+        }
+        return *ring;
+    }
+
+    double seconds_since_epoch() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    void drain_loop() {
+        while (true) {
+            bool stopping;
+            {
+                std::unique_lock<std::mutex> lock(mut);
+                cond.wait_for(lock, std::chrono::milliseconds(50), [this] { return !running; });
+                stopping = !running;
+            }
+            drain();
+            if (stopping) break;
+        }
+    }
+
+    // Writes out every complete slot of every ring. The ring list is copied so threads can keep
+    // registering while this writes.
+    void drain() {
+        std::vector<Ring*> snapshot;
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            for (const auto& ring : rings) snapshot.push_back(ring.get());
+        }
+        bool wrote = false;
+        for (Ring* ring : snapshot) {
+            uint64_t head = ring->head.load(std::memory_order_relaxed);
+            uint64_t tail = ring->tail.load(std::memory_order_acquire);
+            for (; head < tail; ++head) {
+                const Slot& slot = ring->slots[head & (RING_SLOTS - 1)];
+                write_line(*ring, slot);
+                wrote = true;
+            }
+            ring->head.store(head, std::memory_order_release);
+        }
+        if (wrote) std::fflush(sink);
+    }
+
+    void write_line(const Ring& ring, const Slot& slot) {
+        auto since_epoch = slot.time.time_since_epoch();
+        std::time_t seconds = std::chrono::duration_cast<std::chrono::seconds>(since_epoch).count();
+        int millis = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(since_epoch).count() % 1000);
+        std::tm utc{};
+#ifdef _WIN32
+        gmtime_s(&utc, &seconds);
+#else
+        gmtime_r(&seconds, &utc);
+#endif
+        char ts[32];
+        std::strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%S", &utc);
+        std::fprintf(sink, "{\"ts\":\"%s.%03dZ\",\"level\":\"%s\",\"thread\":\"%s\",%.*s}\n", ts, millis,
+                     log_level_name(slot.level), ring.name.c_str(), static_cast<int>(slot.length), slot.text);
+    }
+
+    const std::chrono::steady_clock::time_point epoch;
+    std::atomic<LogLevel> min_level{LogLevel::Info};
+    double rate = 100.0;
+    std::FILE* sink = stderr;
+
+    std::vector<std::unique_ptr<Ring>> rings;
+    std::vector<Ring*> free_rings; // Released by exited threads, waiting for the next one
+    bool running = false;
+    std::mutex mut;               // Mutex to protect rings, free_rings and running (never taken on the logging path once registered)
+    std::condition_variable cond; // Wakes the drain thread for shutdown
+    std::thread drainer;
+};
+
+#endif // ASYNC_LOGGER_HPP
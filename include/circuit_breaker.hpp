@@ -0,0 +1,228 @@
+#ifndef CIRCUIT_BREAKER_HPP
+#define CIRCUIT_BREAKER_HPP
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <deque>
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <ostream>
+
+// A per-host circuit breaker.
+// After `failure_threshold` consecutive connect/timeout failures a host is "opened": its URLs are
+// parked here instead of being fetched. Once the cooldown expires the monitor thread releases one
+// probe URL (half-open). A successful probe closes the breaker and returns the parked URLs to the
+// crawl; a failed probe re-opens it with a doubled cooldown. After `max_reopens` failed probes the
+// host is declared dead and its parked URLs are dropped.
+// Only the probe's own result moves a tripped host on: fetches that started before the breaker
+// tripped may still be finishing, and their failures (or successes) say nothing about the probe.
+class CircuitBreaker {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    CircuitBreaker(int failure_threshold = 5,
+                   std::chrono::seconds cooldown = std::chrono::seconds(30),
+                   int max_reopens = 4,
+                   size_t max_parked_per_host = 10000)
+        : failure_threshold(failure_threshold), base_cooldown(cooldown),
+          max_reopens(max_reopens), max_parked_per_host(max_parked_per_host) {}
+
+    // Called by a worker before fetching `url`.
+    // Returns true if the fetch may proceed (breaker closed, or this URL is the half-open probe).
+    // Returns false if the URL was parked (or dropped, for dead hosts) instead.
+    bool admit(const std::string& host, const std::string& url) {
+        std::lock_guard<std::mutex> lock(mut);
+        auto it = hosts.find(host);
+        if (it == hosts.end() || it->second.state == State::Closed) {
+            return true;
+        }
+        HostState& h = it->second;
+        if (h.state == State::HalfOpen && !h.probe_in_flight && url == h.probe_url) {
+            h.probe_in_flight = true;
+            return true;
+        }
+        // Every URL we do not send to a failing host is a timeout we did not wait for.
+        h.saved += h.avg_failure_cost;
+        if (h.state == State::Dead || h.parked.size() >= max_parked_per_host) {
+            h.dropped++;
+        } else if (h.parked_urls.insert(url).second) { // The frontier may hold the same URL twice
+            h.parked.push_back(url);
+        }
+        return false;
+    }
+
+    // Records a completed fetch of `url` (any HTTP response counts, even 4xx/5xx: the host is reachable).
+    // Returns the URLs parked for this host that should go back onto the crawl queue.
+    std::vector<std::string> record_success(const std::string& host, const std::string& url) {
+        std::lock_guard<std::mutex> lock(mut);
+        auto it = hosts.find(host);
+        if (it == hosts.end()) {
+            return {};
+        }
+        HostState& h = it->second;
+        h.consecutive_failures = 0;
+        if (h.state == State::Dead) {
+            return {}; // A straggler from before the host died; keep it dead.
+        }
+        if (h.state != State::Closed && !is_probe(h, url)) {
+            return {}; // A straggler from before the trip; the probe decides
+        }
+        h.state = State::Closed;
+        h.probe_in_flight = false;
+        h.cooldown = base_cooldown;
+        h.reopens = 0;
+        std::vector<std::string> released(h.parked.begin(), h.parked.end());
+        h.parked.clear();
+        h.parked_urls.clear();
+        return released;
+    }
+
+    // Records a connect/timeout/DNS failure of `url` and how long the worker spent on it.
+    void record_failure(const std::string& host, const std::string& url, Clock::duration cost) {
+        std::lock_guard<std::mutex> lock(mut);
+        HostState& h = hosts[host];
+        h.consecutive_failures++;
+        // Exponentially weighted average, used to estimate the time saved by parking URLs.
+        h.avg_failure_cost = h.avg_failure_cost.count() == 0 ? cost : (h.avg_failure_cost * 3 + cost) / 4;
+
+        if (h.state == State::Closed && h.consecutive_failures >= failure_threshold) {
+            h.state = State::Open;
+            h.cooldown = base_cooldown;
+            h.reopen_at = Clock::now() + h.cooldown;
+            h.trips++;
+        } else if (h.state == State::HalfOpen && is_probe(h, url)) {
+            h.probe_in_flight = false;
+            h.reopens++;
+            if (h.reopens > max_reopens) {
+                h.state = State::Dead;
+                h.dropped += h.parked.size();
+                h.parked.clear();
+                h.parked_urls.clear();
+            } else {
+                h.state = State::Open;
+                h.cooldown *= 2;
+                h.reopen_at = Clock::now() + h.cooldown;
+            }
+        }
+    }
+
+    // Called periodically by the monitor thread.
+    // Moves every open host whose cooldown has expired to half-open and returns one probe URL per host.
+    // A probe that never reached a worker (e.g. it was a duplicate) is replaced after another cooldown.
+    std::vector<std::string> release_probes() {
+        std::lock_guard<std::mutex> lock(mut);
+        std::vector<std::string> probes;
+        Clock::time_point now = Clock::now();
+        for (auto& [host, h] : hosts) {
+            bool due = h.state == State::Open ||
+                       (h.state == State::HalfOpen && !h.probe_in_flight);
+            if (!due || now < h.reopen_at) {
+                continue;
+            }
+            if (h.parked.empty()) {
+                // Nothing left to probe with; the next real URL for this host will act as the probe.
+                h.state = State::Closed;
+                h.consecutive_failures = 0;
+                continue;
+            }
+            h.state = State::HalfOpen;
+            h.probe_url = h.parked.front();
+            h.parked.pop_front();
+            h.parked_urls.erase(h.probe_url);
+            h.reopen_at = now + h.cooldown;
+            probes.push_back(h.probe_url);
+        }
+        return probes;
+    }
+
+    // True while some host still holds parked URLs that may be released later.
+    // The monitor must not stop the crawl while this is true.
+    bool has_pending() const {
+        std::lock_guard<std::mutex> lock(mut);
+        for (const auto& [host, h] : hosts) {
+            if (h.state != State::Dead && (!h.parked.empty() || h.state == State::HalfOpen)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Number of hosts that are currently not closed.
+    size_t tripped_count() const {
+        std::lock_guard<std::mutex> lock(mut);
+        size_t n = 0;
+        for (const auto& [host, h] : hosts) {
+            if (h.state != State::Closed) {
+                n++;
+            }
+        }
+        return n;
+    }
+
+    // Prints every host that has tripped at least once and the estimated worker time saved.
+    void report(std::ostream& out) const {
+        std::lock_guard<std::mutex> lock(mut);
+        Clock::duration total_saved{0};
+        out << "--- Circuit Breaker ---" << std::endl;
+        for (const auto& [host, h] : hosts) {
+            if (h.trips == 0) {
+                continue;
+            }
+            total_saved += h.saved;
+            out << "  " << host << ": " << state_name(h.state)
+                << ", trips: " << h.trips
+                << ", parked: " << h.parked.size()
+                << ", dropped: " << h.dropped
+                << ", worker time saved: " << std::chrono::duration_cast<std::chrono::seconds>(h.saved).count() << "s"
+                << std::endl;
+        }
+        out << "Total worker time saved: "
+            << std::chrono::duration_cast<std::chrono::seconds>(total_saved).count() << "s" << std::endl;
+    }
+
+private:
+    enum class State { Closed, Open, HalfOpen, Dead };
+
+    struct HostState {
+        State state = State::Closed;
+        int consecutive_failures = 0;
+        int reopens = 0;
+        int trips = 0;
+        bool probe_in_flight = false;
+        std::string probe_url;
+        std::deque<std::string> parked;            // In the order they arrived
+        std::unordered_set<std::string> parked_urls; // The same URLs, so none is parked twice
+        size_t dropped = 0;
+        std::chrono::seconds cooldown{0};
+        Clock::time_point reopen_at{};
+        Clock::duration avg_failure_cost{0};
+        Clock::duration saved{0};
+    };
+
+    // True if `url` is the half-open probe a worker is fetching right now.
+    static bool is_probe(const HostState& h, const std::string& url) {
+        return h.state == State::HalfOpen && h.probe_in_flight && url == h.probe_url;
+    }
+
+    static const char* state_name(State s) {
+        switch (s) {
+            case State::Closed: return "closed";
+            case State::Open: return "open";
+            case State::HalfOpen: return "half-open";
+            case State::Dead: return "dead";
+        }
+        return "?";
+    }
+
+    const int failure_threshold;
+    const std::chrono::seconds base_cooldown;
+    const int max_reopens;
+    const size_t max_parked_per_host;
+
+    std::unordered_map<std::string, HostState> hosts;
+    mutable std::mutex mut; // Mutex to protect the host table
+};
+
+#endif // CIRCUIT_BREAKER_HPP
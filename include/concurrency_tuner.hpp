@@ -0,0 +1,122 @@
+#ifndef CONCURRENCY_TUNER_HPP
+#define CONCURRENCY_TUNER_HPP
+
+#include <algorithm>
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// CPU time (user + system) used by every thread of this process so far, in seconds.
+inline double process_cpu_seconds() {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user);
+    auto seconds = [](const FILETIME& t) {
+        return ((static_cast<unsigned long long>(t.dwHighDateTime) << 32) | t.dwLowDateTime) / 1e7;
+    };
+    return seconds(kernel) + seconds(user);
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+#endif
+}
+
+// What the crawl looked like over one monitoring interval.
+struct TunerSample {
+    double pages_per_second = 0;
+    double cpu_utilization = 0; // Process CPU time / (interval * cores), 0..1
+    double io_wait = 0;         // Share of the workers' time spent waiting on fetches, 0..1
+    bool starved = false;       // The frontier ran dry: workers idle for lack of URLs, not of threads
+};
+
+// Picks the worker count by hill climbing on throughput.
+//
+// Each interval it compares pages/s with the previous interval. If the last change helped, it takes
+// a bigger step the same way; if it hurt, it takes the change back and waits a few intervals. Once
+// settled it probes now and then: upwards while the workers mostly wait on the network (more
+// requests in flight should help), downwards otherwise (threads that do not add throughput only
+// add memory and contention). A CPU-saturated process is shrunk until a shrink costs throughput,
+// and a starved frontier is no evidence either way, so nothing changes then.
+class ConcurrencyTuner {
+public:
+    ConcurrencyTuner(int initial, int min_threads, int max_threads)
+        : current(std::clamp(initial, min_threads, max_threads)), min_threads(min_threads), max_threads(max_threads) {}
+
+    static constexpr double CPU_CEILING = 0.90; // Above this, more threads only queue for cores
+    static constexpr double NOISE = 0.05;       // Throughput changes smaller than 5% are noise
+    static constexpr double IO_BOUND = 0.60;    // Workers waiting on fetches this much of the time want company
+    static constexpr int SETTLE_INTERVALS = 3;  // Intervals to hold after a change was taken back
+
+    int threads() const { return current; }
+
+    // Why the last observe() did what it did, for the log.
+    const char* reason() const { return last_reason; }
+
+    // Feeds one interval's measurements; returns the worker count to run with next.
+    int observe(const TunerSample& sample) {
+        int delta = 0;
+        if (sample.starved) {
+            last_reason = "frontier starved";
+            previous_rate = 0; // Throughput now says nothing about the thread count
+            last_delta = 0;
+            return current;
+        }
+        bool judged = last_delta != 0 && previous_rate > 0;
+        double gain = judged ? (sample.pages_per_second - previous_rate) / previous_rate : 0.0;
+        bool shrink_hurt = judged && last_delta < 0 && gain < -NOISE;
+        bool judge_next = true;
+        if (sample.cpu_utilization > CPU_CEILING && current > min_threads && !shrink_hurt && hold == 0) {
+            delta = -std::max(1, current / 8);
+            step = 1;
+            last_reason = "CPU saturated";
+        } else if (judged) {
+            if (gain > NOISE) {
+                delta = last_delta > 0 ? step : -step; // Keep going the way that paid off
+                step = std::min(step * 2, std::max(1, current / 2));
+                last_reason = "throughput improved";
+            } else if (gain < -NOISE) {
+                delta = -last_delta; // Take it back, and do not read the recovery as a gain
+                judge_next = false;
+                step = 1;
+                hold = SETTLE_INTERVALS;
+                last_reason = "throughput dropped";
+            } else {
+                step = 1;
+                hold = SETTLE_INTERVALS;
+                last_reason = "throughput flat";
+            }
+        } else if (hold > 0) {
+            hold--;
+            last_reason = "settling";
+        } else if (sample.io_wait > IO_BOUND) {
+            delta = step;
+            last_reason = "probing up (I/O bound)";
+        } else {
+            delta = -step;
+            last_reason = "probing down";
+        }
+
+        int next = std::clamp(current + delta, min_threads, max_threads);
+        last_delta = judge_next ? next - current : 0;
+        previous_rate = sample.pages_per_second;
+        current = next;
+        return current;
+    }
+
+private:
+    int current;
+    const int min_threads;
+    const int max_threads;
+    int step = 1;
+    int last_delta = 0;     // Change made after the previous interval
+    int hold = 0;
+    double previous_rate = 0;
+    const char* last_reason = "";
+};
+
+#endif // CONCURRENCY_TUNER_HPP
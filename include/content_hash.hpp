@@ -0,0 +1,171 @@
+#ifndef CONTENT_HASH_HPP
+#define CONTENT_HASH_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_set>
+#include <unordered_map>
+#include <map>
+#include <mutex>
+#include <array>
+#include <ostream>
+#include <iomanip>
+
+#if __has_include(<xxhash.h>)
+#define XXH_INLINE_ALL
+#include <xxhash.h>
+#define CRAWLER_HAVE_XXH3 1
+#endif
+
+// 64-bit hash of a response body.
+// Uses XXH3 when xxhash.h is available; otherwise falls back to the self-contained XXH64 below.
+// XXH64 keeps four independent accumulator lanes, so the main loop has no cross-lane dependency
+// and the compiler can keep all four multiplies in flight at once.
+namespace content_hash_detail {
+
+constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t read64(const unsigned char* p) { uint64_t v; std::memcpy(&v, p, 8); return v; }
+inline uint32_t read32(const unsigned char* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+
+inline uint64_t xxh_round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME2;
+    acc = rotl(acc, 31);
+    return acc * PRIME1;
+}
+
+inline uint64_t merge_round(uint64_t acc, uint64_t val) {
+    acc ^= xxh_round(0, val);
+    return acc * PRIME1 + PRIME4;
+}
+
+inline uint64_t xxh64(const void* data, size_t len, uint64_t seed = 0) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        uint64_t v1 = seed + PRIME1 + PRIME2;
+        uint64_t v2 = seed + PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME1;
+        const unsigned char* limit = end - 32;
+        do {
+            v1 = xxh_round(v1, read64(p));
+            v2 = xxh_round(v2, read64(p + 8));
+            v3 = xxh_round(v3, read64(p + 16));
+            v4 = xxh_round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge_round(h, v1);
+        h = merge_round(h, v2);
+        h = merge_round(h, v3);
+        h = merge_round(h, v4);
+    } else {
+        h = seed + PRIME5;
+    }
+
+    h += static_cast<uint64_t>(len);
+    while (p + 8 <= end) {
+        h ^= xxh_round(0, read64(p));
+        h = rotl(h, 27) * PRIME1 + PRIME4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= static_cast<uint64_t>(read32(p)) * PRIME1;
+        h = rotl(h, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * PRIME5;
+        h = rotl(h, 11) * PRIME1;
+        p++;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+} // namespace content_hash_detail
+
+inline uint64_t content_hash(const char* data, size_t len) {
+#ifdef CRAWLER_HAVE_XXH3
+    return XXH3_64bits(data, len);
+#else
+    return content_hash_detail::xxh64(data, len);
+#endif
+}
+
+inline uint64_t content_hash(const std::string& body) {
+    return content_hash(body.data(), body.size());
+}
+
+// A concurrent store of content fingerprints with per-host duplicate statistics.
+// The fingerprints are split over independently locked shards (picked by the hash's high bits),
+// so workers checking different bodies almost never wait on each other. The per-host counts live
+// in the shard that was locked anyway, and are only summed up for the report.
+class FingerprintStore {
+public:
+    // Records that `host` served a body with fingerprint `hash`.
+    // Returns true if this fingerprint was seen before (on any host), i.e. the body is a duplicate.
+    bool check_and_insert(const std::string& host, uint64_t hash) {
+        Shard& shard = shards[hash >> (64 - SHARD_BITS)];
+        std::lock_guard<std::mutex> lock(shard.mut);
+        bool duplicate = !shard.fingerprints.insert(hash).second;
+        HostCounts& counts = shard.host_counts[host];
+        counts.pages++;
+        if (duplicate) {
+            counts.duplicates++;
+        }
+        return duplicate;
+    }
+
+    // Prints pages, duplicates and the duplicate ratio for every host.
+    void report(std::ostream& out) const {
+        std::map<std::string, HostCounts> host_counts;
+        for (const Shard& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mut);
+            for (const auto& [host, counts] : shard.host_counts) {
+                host_counts[host].pages += counts.pages;
+                host_counts[host].duplicates += counts.duplicates;
+            }
+        }
+        out << "--- Duplicate Content ---" << std::endl;
+        for (const auto& [host, counts] : host_counts) {
+            double ratio = counts.pages ? 100.0 * counts.duplicates / counts.pages : 0.0;
+            out << "  " << host << ": " << counts.duplicates << " / " << counts.pages
+                << " pages duplicate (" << std::fixed << std::setprecision(1) << ratio << "%)"
+                << std::defaultfloat << std::endl;
+        }
+    }
+
+private:
+    static constexpr int SHARD_BITS = 6;
+
+    struct HostCounts {
+        size_t pages = 0;
+        size_t duplicates = 0;
+    };
+
+    struct Shard {
+        std::unordered_set<uint64_t> fingerprints;
+        std::unordered_map<std::string, HostCounts> host_counts; // Bodies of this shard, per host
+        mutable std::mutex mut; // Mutex to protect this shard
+    };
+
+    std::array<Shard, 1 << SHARD_BITS> shards;
+};
+
+#endif // CONTENT_HASH_HPP
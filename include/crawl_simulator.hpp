@@ -0,0 +1,356 @@
+#ifndef CRAWL_SIMULATOR_HPP
+#define CRAWL_SIMULATOR_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <optional>
+
+#include "thread_safe_queue.hpp"
+#include "thread_safe_set.hpp"
+#include "latency_histogram.hpp"
+#include "page_names.hpp"
+
+struct SimulationOptions {
+    uint64_t seed = 1;
+    // --- The simulated web ---
+    uint32_t hosts = 1000;
+    uint32_t pages_per_host = 1000;  // Median; each host's size is drawn around it
+    uint32_t links_per_page = 10;
+    double cross_host_links = 0.05;  // Fraction of links that point at another host
+    double rtt_ms = 50;              // Median round trip; each host gets its own
+    double bandwidth_kb = 1000;      // Median per-connection bandwidth in KB/s
+    double page_kb = 32;             // Median page size
+    uint32_t host_slots = 4;         // Requests a host serves at once; more wait in its queue
+    // --- The crawler ---
+    uint32_t workers = 4;
+    double parse_us_per_kb = 20;     // Worker CPU time spent parsing and extracting
+    uint64_t max_pages = 0;          // Stop after this many fetches (0: crawl everything reachable)
+    double politeness_ms = 0;        // Scheduler policy: minimum gap between requests to one host (0: none)
+    double polite_interval_ms = 1000; // Requests to one host closer together than this are violations
+};
+
+struct SimulationResult {
+    uint64_t pages = 0;
+    uint64_t bytes = 0;
+    uint64_t links_seen = 0;
+    uint64_t duplicate_links = 0;
+    uint64_t events = 0;
+    uint64_t simulated_micros = 0;
+    size_t frontier_peak = 0;
+    uint64_t parked = 0;                // URLs the politeness policy had to hold back
+    uint64_t politeness_violations = 0;
+    uint32_t hosts_crawled = 0;
+    uint32_t hosts_violated = 0;
+    uint32_t max_host_concurrency = 0;  // Most requests ever outstanding to one host
+    LatencyHistogram fetch_latency;     // Request issued to response complete, including the host's queue
+
+    double simulated_seconds() const { return simulated_micros / 1e6; }
+    double pages_per_second() const { return simulated_micros ? pages / simulated_seconds() : 0.0; }
+};
+
+// Deterministic discrete-event simulation of a crawl.
+//
+// The frontier (ThreadSafeQueue) and the dedup set (ThreadSafeSet) are the crawler's own; the
+// network, the web and the workers are modeled. Every host gets a round-trip time, a bandwidth and a
+// page count drawn from the seed, every page gets a size and outlinks computed from its id, and a
+// fetch takes RTT + size / bandwidth once the host has a free slot. Workers pop URLs, fetch, spend
+// parse time, enqueue the new links and pop again. Time is a virtual clock advanced from event to
+// event, so a crawl of millions of pages runs as fast as the queue and set operations allow, and the
+// same seed always gives the same crawl.
+//
+// Unlike the live crawler, URLs are marked seen when they are enqueued rather than when they are
+// popped, so the frontier holds every URL at most once and stays bounded at millions of pages.
+class CrawlSimulator {
+public:
+    explicit CrawlSimulator(const SimulationOptions& options) : options(options) {
+        host_states.resize(options.hosts);
+        for (uint32_t h = 0; h < options.hosts; ++h) {
+            HostState& host = host_states[h];
+            host.pages = std::max<uint32_t>(1, static_cast<uint32_t>(
+                lognormal(options.pages_per_host, 1.0, mix(h, 1))));
+            host.rtt_micros = static_cast<uint64_t>(lognormal(options.rtt_ms * 1000, 0.5, mix(h, 2)));
+            host.bytes_per_micro = lognormal(options.bandwidth_kb * 1024 / 1e6, 0.5, mix(h, 3));
+        }
+        politeness_micros = static_cast<uint64_t>(options.politeness_ms * 1000);
+        polite_interval_micros = static_cast<uint64_t>(options.polite_interval_ms * 1000);
+    }
+
+    static std::string url_of(uint32_t host, uint32_t page) {
+        return "http://" + page_name(host) + ".sim/" + page_name(page);
+    }
+
+    SimulationResult run() {
+        result = SimulationResult();
+        enqueue(url_of(0, 0));
+        for (uint32_t w = 0; w < options.workers; ++w) idle_workers.push_back(w);
+        dispatch();
+
+        while (!events.empty()) {
+            Event event = events.top();
+            events.pop();
+            now = event.time;
+            result.events++;
+            switch (event.kind) {
+            case EventKind::FetchDone:
+                fetch_done(event);
+                break;
+            case EventKind::ParseDone:
+                parse_done(event);
+                break;
+            case EventKind::HostReady:
+                host_ready(event.host);
+                break;
+            }
+            dispatch();
+        }
+
+        result.simulated_micros = now;
+        for (const HostState& host : host_states) {
+            result.hosts_crawled += host.fetches > 0;
+            result.hosts_violated += host.violations > 0;
+        }
+        return result;
+    }
+
+private:
+    enum class EventKind { FetchDone, ParseDone, HostReady };
+
+    struct Event {
+        uint64_t time;
+        uint64_t sequence; // Ties are broken by scheduling order, which keeps runs reproducible
+        EventKind kind;
+        uint32_t worker;
+        uint32_t host;
+        uint32_t page;
+        uint64_t issued;   // When the request was sent (FetchDone)
+        bool operator>(const Event& other) const {
+            return time != other.time ? time > other.time : sequence > other.sequence;
+        }
+    };
+
+    struct Request {
+        uint32_t worker;
+        uint32_t page;
+        uint64_t issued;
+    };
+
+    struct HostState {
+        uint32_t pages = 0;
+        uint64_t rtt_micros = 0;
+        double bytes_per_micro = 0;
+        uint32_t busy = 0;              // Slots serving a request
+        uint32_t outstanding = 0;       // Requests sent and not yet answered
+        std::deque<Request> waiting;    // Requests the host has not started serving
+        uint64_t fetches = 0;
+        uint64_t last_request = 0;
+        uint64_t next_allowed = 0;      // Politeness policy: earliest next request
+        std::deque<std::string> parked; // URLs held back by the politeness policy
+        bool wake_scheduled = false;
+        uint64_t violations = 0;
+    };
+
+    // --- Deterministic randomness ---
+
+    // splitmix64 of the seed and two ids: the same inputs always give the same value.
+    uint64_t mix(uint64_t a, uint64_t b) const {
+        uint64_t z = options.seed * 0x9E3779B97F4A7C15ULL + a * 0xBF58476D1CE4E5B9ULL + b * 0x94D049BB133111EBULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    static double unit(uint64_t bits) { return ((bits >> 11) + 0.5) * (1.0 / 9007199254740992.0); }
+
+    // Log-normal value with the given median, from two uniform draws (Box-Muller).
+    static double lognormal(double median, double sigma, uint64_t bits) {
+        double u1 = unit(bits), u2 = unit(bits * 0x9E3779B97F4A7C15ULL + 1);
+        double normal = std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+        return median * std::exp(sigma * normal);
+    }
+
+    // --- URLs ---
+
+    // Host and page names are page_names.hpp numbers: http://<host>.sim/<page>
+    static void parse_url(const std::string& url, uint32_t& host, uint32_t& page) {
+        std::string_view view(url);
+        size_t host_begin = 7; // "http://"
+        size_t host_end = url.find('.', host_begin);
+        uint64_t id = 0;
+        parse_page_name(view.substr(host_begin, host_end - host_begin), id);
+        host = static_cast<uint32_t>(id);
+        parse_page_name(view.substr(host_end + 5), id); // ".sim/"
+        page = static_cast<uint32_t>(id);
+    }
+
+    // --- The simulated web ---
+
+    uint64_t page_bytes(uint32_t host, uint32_t page) const {
+        return static_cast<uint64_t>(lognormal(options.page_kb * 1024, 0.6, mix(host, uint64_t(page) << 8 | 4)));
+    }
+
+    // Outlinks of a page. The first ones form a tree over the host's pages, so all of them are
+    // reachable from its root; the rest point at random pages of the same host or, for a
+    // `cross_host_links` fraction, at the upper part of another host.
+    void outlinks(uint32_t host, uint32_t page, std::vector<std::string>& links) const {
+        const HostState& state = host_states[host];
+        uint32_t tree = std::max<uint32_t>(1, options.links_per_page / 2);
+        for (uint32_t k = 1; k <= tree; ++k) {
+            uint64_t child = uint64_t(page) * tree + k;
+            if (child < state.pages) links.push_back(url_of(host, static_cast<uint32_t>(child)));
+        }
+        for (uint32_t k = tree; k < options.links_per_page; ++k) {
+            uint64_t bits = mix(uint64_t(host) << 32 | page, k + 16);
+            if (unit(bits) < options.cross_host_links) {
+                uint32_t other = static_cast<uint32_t>((bits >> 8) % options.hosts);
+                uint32_t target = static_cast<uint32_t>((bits >> 40) % std::min<uint32_t>(host_states[other].pages, 64));
+                links.push_back(url_of(other, target));
+            } else {
+                links.push_back(url_of(host, static_cast<uint32_t>((bits >> 8) % state.pages)));
+            }
+        }
+    }
+
+    // --- Scheduler ---
+
+    void schedule(uint64_t time, EventKind kind, uint32_t worker, uint32_t host, uint32_t page = 0, uint64_t issued = 0) {
+        events.push(Event{time, next_sequence++, kind, worker, host, page, issued});
+    }
+
+    void enqueue(const std::string& url) {
+        result.links_seen++;
+        if (!seen.insert(url)) {
+            result.duplicate_links++;
+            return;
+        }
+        frontier.push(url);
+        frontier_size++;
+        result.frontier_peak = std::max(result.frontier_peak, frontier_size);
+    }
+
+    // Hands frontier URLs to idle workers until one of the two runs out.
+    void dispatch() {
+        while (!idle_workers.empty() && !limit_reached()) {
+            std::optional<std::string> url = frontier.try_pop();
+            if (!url) return;
+            frontier_size--;
+            uint32_t host_id = 0, page = 0;
+            parse_url(*url, host_id, page);
+            HostState& host = host_states[host_id];
+
+            if (politeness_micros > 0 && now < host.next_allowed) {
+                host.parked.push_back(std::move(*url));
+                result.parked++;
+                if (!host.wake_scheduled) {
+                    host.wake_scheduled = true;
+                    schedule(host.next_allowed, EventKind::HostReady, 0, host_id);
+                }
+                continue;
+            }
+
+            uint32_t worker = idle_workers.back();
+            idle_workers.pop_back();
+            send_request(host_id, Request{worker, page, now});
+        }
+    }
+
+    bool limit_reached() const {
+        return options.max_pages > 0 && started >= options.max_pages;
+    }
+
+    void send_request(uint32_t host_id, const Request& request) {
+        HostState& host = host_states[host_id];
+        started++;
+        if (host.fetches > 0 && now - host.last_request < polite_interval_micros) {
+            host.violations++;
+            result.politeness_violations++;
+        }
+        host.fetches++;
+        host.last_request = now;
+        host.next_allowed = now + politeness_micros;
+        if (!host.parked.empty() && !host.wake_scheduled) {
+            host.wake_scheduled = true;
+            schedule(host.next_allowed, EventKind::HostReady, 0, host_id);
+        }
+        host.outstanding++;
+        result.max_host_concurrency = std::max(result.max_host_concurrency, host.outstanding);
+        if (host.busy < options.host_slots) {
+            serve(host_id, request);
+        } else {
+            host.waiting.push_back(request);
+        }
+    }
+
+    void serve(uint32_t host_id, const Request& request) {
+        HostState& host = host_states[host_id];
+        host.busy++;
+        uint64_t transfer = static_cast<uint64_t>(page_bytes(host_id, request.page) / host.bytes_per_micro);
+        schedule(now + host.rtt_micros + transfer, EventKind::FetchDone, request.worker, host_id, request.page, request.issued);
+    }
+
+    void fetch_done(const Event& event) {
+        HostState& host = host_states[event.host];
+        host.busy--;
+        host.outstanding--;
+        if (!host.waiting.empty()) {
+            Request next = host.waiting.front();
+            host.waiting.pop_front();
+            serve(event.host, next);
+        }
+        uint64_t bytes = page_bytes(event.host, event.page);
+        result.pages++;
+        result.bytes += bytes;
+        result.fetch_latency.add(now - event.issued);
+        uint64_t parse = static_cast<uint64_t>(options.parse_us_per_kb * bytes / 1024);
+        schedule(now + parse, EventKind::ParseDone, event.worker, event.host, event.page);
+    }
+
+    void parse_done(const Event& event) {
+        links.clear();
+        outlinks(event.host, event.page, links);
+        for (const std::string& link : links) enqueue(link);
+        idle_workers.push_back(event.worker);
+    }
+
+    // The politeness delay of a host with parked URLs has passed: send the oldest one if a worker
+    // is free, or put it back in the frontier. Sending it schedules the wake-up for the next one.
+    void host_ready(uint32_t host_id) {
+        HostState& host = host_states[host_id];
+        host.wake_scheduled = false;
+        if (host.parked.empty()) return;
+        std::string url = std::move(host.parked.front());
+        host.parked.pop_front();
+        if (!idle_workers.empty() && !limit_reached()) {
+            uint32_t worker = idle_workers.back();
+            idle_workers.pop_back();
+            uint32_t page = 0;
+            parse_url(url, host_id, page);
+            send_request(host_id, Request{worker, page, now});
+        } else {
+            frontier.push(std::move(url));
+            frontier_size++;
+        }
+    }
+
+    const SimulationOptions options;
+    std::vector<HostState> host_states;
+    uint64_t politeness_micros = 0;
+    uint64_t polite_interval_micros = 0;
+
+    ThreadSafeQueue<std::string> frontier{"sim_frontier"};
+    ThreadSafeSet seen{"sim_seen"};
+    size_t frontier_size = 0;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    uint64_t next_sequence = 0;
+    uint64_t now = 0;
+    uint64_t started = 0;
+    std::vector<uint32_t> idle_workers;
+    std::vector<std::string> links; // Reused by parse_done
+    SimulationResult result;
+};
+
+#endif // CRAWL_SIMULATOR_HPP
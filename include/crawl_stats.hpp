@@ -0,0 +1,72 @@
+#ifndef CRAWL_STATS_HPP
+#define CRAWL_STATS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Running totals of what the workers fetched, for the metrics endpoint and the final summary.
+// Everything except the per-host in-flight map is a relaxed atomic, so recording costs a few
+// uncontended increments and reading never blocks a worker.
+class CrawlStats {
+public:
+    static constexpr int MAX_ERROR_CODE = 128; // Covers every CURLcode
+
+    // Counts one HTTP response (any hop of a redirect chain) and its size on the wire.
+    void record_response(long status, size_t bytes) {
+        responses.fetch_add(1, std::memory_order_relaxed);
+        downloaded.fetch_add(bytes, std::memory_order_relaxed);
+        size_t status_class = status >= 100 && status < 600 ? static_cast<size_t>(status / 100) : 0;
+        status_classes[status_class].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Counts a transfer that failed below HTTP (DNS, connect, timeout, TLS, ...), by CURLcode.
+    void record_error(int code) {
+        errors[code > 0 && code < MAX_ERROR_CODE ? code : 0].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void fetch_started(const std::string& host) {
+        std::lock_guard<std::mutex> lock(in_flight_mut);
+        in_flight[host]++;
+    }
+
+    void fetch_finished(const std::string& host) {
+        std::lock_guard<std::mutex> lock(in_flight_mut);
+        auto it = in_flight.find(host);
+        if (it != in_flight.end() && --it->second == 0) {
+            in_flight.erase(it);
+        }
+    }
+
+    uint64_t response_count() const { return responses.load(std::memory_order_relaxed); }
+    uint64_t bytes_downloaded() const { return downloaded.load(std::memory_order_relaxed); }
+
+    // Responses per status class: index 1 for 1xx ... 5 for 5xx, 0 for anything else
+    uint64_t status_class_count(size_t status_class) const {
+        return status_classes[status_class].load(std::memory_order_relaxed);
+    }
+
+    uint64_t error_count(int code) const { return errors[code].load(std::memory_order_relaxed); }
+
+    // Hosts with at least one fetch in progress, and how many.
+    std::vector<std::pair<std::string, int>> hosts_in_flight() const {
+        std::lock_guard<std::mutex> lock(in_flight_mut);
+        return std::vector<std::pair<std::string, int>>(in_flight.begin(), in_flight.end());
+    }
+
+private:
+    std::atomic<uint64_t> responses{0};
+    std::atomic<uint64_t> downloaded{0};
+    std::array<std::atomic<uint64_t>, 6> status_classes{};
+    std::array<std::atomic<uint64_t>, MAX_ERROR_CODE> errors{};
+
+    std::unordered_map<std::string, int> in_flight;
+    mutable std::mutex in_flight_mut; // Mutex to protect in_flight
+};
+
+#endif // CRAWL_STATS_HPP
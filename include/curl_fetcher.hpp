@@ -0,0 +1,226 @@
+#ifndef CURL_FETCHER_HPP
+#define CURL_FETCHER_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <stdexcept>
+#include <curl/curl.h>
+
+#include "fetcher.hpp"
+
+// Settings and response handling shared by the two libcurl transports.
+class CurlTransfer {
+public:
+    // One request in progress; its buffers are filled by curl's callbacks.
+    struct State {
+        FetchResponse response;
+        Fetcher::Completion done;
+    };
+
+    // Sets every option a crawler request needs on `handle` and points its buffers at `state`.
+    // With `capture_request_headers` (used by --warc) the headers curl sends are kept too.
+    static void configure(CURL* handle, State& state, bool capture_request_headers) {
+        curl_easy_setopt(handle, CURLOPT_URL, state.response.url.c_str());
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, write_callback);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &state.response.body);
+        curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, header_callback);
+        curl_easy_setopt(handle, CURLOPT_HEADERDATA, &state.response.response_headers);
+        if (capture_request_headers) {
+            // The request headers are only exposed to the debug callback
+            curl_easy_setopt(handle, CURLOPT_DEBUGFUNCTION, debug_callback);
+            curl_easy_setopt(handle, CURLOPT_DEBUGDATA, &state.response.request_headers);
+            curl_easy_setopt(handle, CURLOPT_VERBOSE, 1L);
+        }
+        curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 0L); // Redirects are followed by fetch_page, hop by hop
+        curl_easy_setopt(handle, CURLOPT_USERAGENT, "MySimpleCrawler/1.0"); // Be polite, identify crawler
+        curl_easy_setopt(handle, CURLOPT_CAINFO, "cacert.pem"); // Path to CA cert bundle
+        curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, 1L); // Verify the server's SSL certificate
+        curl_easy_setopt(handle, CURLOPT_SSL_VERIFYHOST, 2L); // Verify the certificate's name against host
+        // Set timeouts to prevent threads from getting stuck indefinitely
+        curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT, 10L); // 10 seconds to connect
+        curl_easy_setopt(handle, CURLOPT_TIMEOUT, 20L); // 20 seconds for the entire transfer
+    }
+
+    // Fills in what curl knows about the finished transfer.
+    static void finish(CURL* handle, CURLcode result, FetchResponse& response) {
+        response.error = result;
+        if (result != CURLE_OK) return;
+        char* effective = nullptr;
+        if (curl_easy_getinfo(handle, CURLINFO_EFFECTIVE_URL, &effective) == CURLE_OK && effective) {
+            response.url = effective;
+        }
+        curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &response.status);
+        char* content_type = nullptr;
+        if (curl_easy_getinfo(handle, CURLINFO_CONTENT_TYPE, &content_type) == CURLE_OK && content_type) {
+            response.content_type = content_type;
+        }
+        char* location = nullptr;
+        if (curl_easy_getinfo(handle, CURLINFO_REDIRECT_URL, &location) == CURLE_OK && location) {
+            response.location = location; // Absolute, already resolved by curl
+        }
+        curl_off_t value = 0;
+        curl_easy_getinfo(handle, CURLINFO_NAMELOOKUP_TIME_T, &value);
+        response.times.dns = value;
+        curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME_T, &value);
+        response.times.connect = value;
+        curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME_T, &value);
+        response.times.tls = value;
+        curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME_T, &value);
+        response.times.first_byte = value;
+        curl_easy_getinfo(handle, CURLINFO_TOTAL_TIME_T, &value);
+        response.times.total = value;
+    }
+
+private:
+    static size_t write_callback(void* contents, size_t size, size_t nmemb, void* userp) {
+        size_t total_size = size * nmemb;
+        static_cast<std::string*>(userp)->append(static_cast<char*>(contents), total_size);
+        return total_size;
+    }
+
+    // Collects the raw response header block. A new status line (e.g. after "100 Continue") starts over.
+    static size_t header_callback(char* buffer, size_t size, size_t nitems, void* userp) {
+        size_t total_size = size * nitems;
+        std::string* headers = static_cast<std::string*>(userp);
+        if (total_size >= 5 && std::string(buffer, 5) == "HTTP/") {
+            headers->clear();
+        }
+        headers->append(buffer, total_size);
+        return total_size;
+    }
+
+    static int debug_callback(CURL*, curl_infotype type, char* data, size_t size, void* userp) {
+        if (type == CURLINFO_HEADER_OUT) {
+            static_cast<std::string*>(userp)->assign(data, size);
+        }
+        return 0;
+    }
+};
+
+// Blocking transport: one easy handle, one request at a time. submit() performs the transfer on the
+// spot and poll() only runs the completion. The handle is reused, so connections are kept alive.
+class CurlEasyFetcher : public Fetcher {
+public:
+    explicit CurlEasyFetcher(bool capture_request_headers = false)
+        : handle(curl_easy_init()), capture_request_headers(capture_request_headers) {
+        if (!handle) throw std::runtime_error("curl_easy_init failed");
+    }
+
+    ~CurlEasyFetcher() override { curl_easy_cleanup(handle); }
+
+    const char* name() const override { return "easy"; }
+
+    void submit(FetchRequest request, Completion done) override {
+        auto state = std::make_unique<CurlTransfer::State>();
+        state->response.url = std::move(request.url);
+        state->done = std::move(done);
+        CurlTransfer::configure(handle, *state, capture_request_headers);
+        CURLcode result = curl_easy_perform(handle);
+        CurlTransfer::finish(handle, result, state->response);
+        finished.push_back(std::move(state));
+    }
+
+    size_t poll(int) override {
+        size_t completed = 0;
+        while (!finished.empty()) {
+            std::unique_ptr<CurlTransfer::State> state = std::move(finished.front());
+            finished.pop_front();
+            state->done(state->response);
+            completed++;
+        }
+        return completed;
+    }
+
+    size_t pending() const override { return finished.size(); }
+
+private:
+    CURL* handle;
+    const bool capture_request_headers;
+    std::deque<std::unique_ptr<CurlTransfer::State>> finished;
+};
+
+// Non-blocking transport on a curl multi handle: submitted requests run concurrently and poll()
+// drives them all. Finished easy handles go back to a pool, and the multi handle's connection
+// cache is shared by all of them.
+class CurlMultiFetcher : public Fetcher {
+public:
+    explicit CurlMultiFetcher(bool capture_request_headers = false)
+        : multi(curl_multi_init()), capture_request_headers(capture_request_headers) {
+        if (!multi) throw std::runtime_error("curl_multi_init failed");
+    }
+
+    ~CurlMultiFetcher() override {
+        for (auto& [handle, state] : running) {
+            curl_multi_remove_handle(multi, handle);
+            curl_easy_cleanup(handle);
+        }
+        for (CURL* handle : idle) curl_easy_cleanup(handle);
+        curl_multi_cleanup(multi);
+    }
+
+    const char* name() const override { return "multi"; }
+
+    void submit(FetchRequest request, Completion done) override {
+        CURL* handle = nullptr;
+        if (!idle.empty()) {
+            handle = idle.back();
+            idle.pop_back();
+            curl_easy_reset(handle);
+        } else if (!(handle = curl_easy_init())) {
+            throw std::runtime_error("curl_easy_init failed");
+        }
+        auto state = std::make_unique<CurlTransfer::State>();
+        state->response.url = std::move(request.url);
+        state->done = std::move(done);
+        CurlTransfer::configure(handle, *state, capture_request_headers);
+        curl_multi_add_handle(multi, handle);
+        running.emplace_back(handle, std::move(state));
+    }
+
+    size_t poll(int timeout_ms) override {
+        if (running.empty()) return 0;
+        int still_running = 0;
+        curl_multi_perform(multi, &still_running);
+        size_t completed = drain();
+        if (completed == 0 && still_running > 0) {
+            curl_multi_poll(multi, nullptr, 0, timeout_ms, nullptr);
+            curl_multi_perform(multi, &still_running);
+            completed = drain();
+        }
+        return completed;
+    }
+
+    size_t pending() const override { return running.size(); }
+
+private:
+    // Runs the completion of every transfer curl reports as done.
+    size_t drain() {
+        size_t completed = 0;
+        int queued = 0;
+        while (CURLMsg* message = curl_multi_info_read(multi, &queued)) {
+            if (message->msg != CURLMSG_DONE) continue;
+            CURL* handle = message->easy_handle;
+            CURLcode result = message->data.result;
+            auto it = running.begin();
+            while (it != running.end() && it->first != handle) ++it;
+            std::unique_ptr<CurlTransfer::State> state = std::move(it->second);
+            running.erase(it);
+            CurlTransfer::finish(handle, result, state->response);
+            curl_multi_remove_handle(multi, handle);
+            idle.push_back(handle);
+            state->done(state->response);
+            completed++;
+        }
+        return completed;
+    }
+
+    CURLM* multi;
+    const bool capture_request_headers;
+    std::vector<std::pair<CURL*, std::unique_ptr<CurlTransfer::State>>> running; // Few at a time; a linear scan is fine
+    std::vector<CURL*> idle;
+};
+
+#endif // CURL_FETCHER_HPP
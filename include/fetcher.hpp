@@ -0,0 +1,119 @@
+#ifndef FETCHER_HPP
+#define FETCHER_HPP
+
+#include <string>
+#include <functional>
+#include <map>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cstdint>
+#include <curl/curl.h>
+
+// Cumulative transfer times in microseconds since the request started (curl's *_TIME_T
+// convention). Phases a transport does not have (DNS for an in-process mock, ...) stay zero.
+struct TransferTimes {
+    int64_t dns = 0;
+    int64_t connect = 0;
+    int64_t tls = 0;       // Zero for plain HTTP
+    int64_t first_byte = 0;
+    int64_t total = 0;
+};
+
+struct FetchRequest {
+    std::string url;
+};
+
+// Outcome of a single HTTP exchange. Redirects are not followed; `location` says where one points.
+struct FetchResponse {
+    CURLcode error = CURLE_OK;    // Every transport reports failures as curl codes, so stats, logs and
+                                  // the circuit breaker treat them the same whatever the transport
+    long status = 0;
+    std::string url;              // URL actually requested
+    std::string content_type;
+    std::string location;         // Absolute redirect target of a 3xx, "" otherwise
+    std::string request_headers;  // Raw request header block, if the transport captures it
+    std::string response_headers; // Raw response header block
+    std::string body;
+    TransferTimes times;
+};
+
+// A transport. Requests are asynchronous: submit() starts one and returns, and its completion runs
+// later inside poll(), on the thread that called poll(). A Fetcher belongs to one thread (curl
+// handles cannot be shared between threads), so every worker creates its own.
+class Fetcher {
+public:
+    using Completion = std::function<void(FetchResponse&)>;
+
+    virtual ~Fetcher() = default;
+
+    virtual const char* name() const = 0;
+
+    virtual void submit(FetchRequest request, Completion done) = 0;
+
+    // Runs the completions of finished requests, waiting up to timeout_ms for the first one.
+    // Returns how many completions ran.
+    virtual size_t poll(int timeout_ms) = 0;
+
+    // Requests submitted whose completion has not run yet.
+    virtual size_t pending() const = 0;
+
+    // Fetches one URL and waits for it.
+    FetchResponse fetch(FetchRequest request) {
+        FetchResponse result;
+        bool done = false;
+        submit(std::move(request), [&](FetchResponse& response) {
+            result = std::move(response);
+            done = true;
+        });
+        while (!done) {
+            poll(1000);
+        }
+        return result;
+    }
+};
+
+// Base for in-process transports (replay, mock): the response is built at submit() and handed out
+// by poll() once its simulated latency has passed, so several requests can be in flight at once
+// just as with a network transport.
+class DelayedFetcher : public Fetcher {
+public:
+    void submit(FetchRequest request, Completion done) override {
+        uint64_t delay_micros = 0;
+        FetchResponse response = respond(request, delay_micros);
+        response.url = request.url;
+        response.times.first_byte = static_cast<int64_t>(delay_micros);
+        response.times.total = static_cast<int64_t>(delay_micros);
+        auto ready_at = std::chrono::steady_clock::now() + std::chrono::microseconds(delay_micros);
+        in_flight.emplace(ready_at, Entry{std::move(response), std::move(done)});
+    }
+
+    size_t poll(int timeout_ms) override {
+        if (in_flight.empty()) return 0;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        std::this_thread::sleep_until(std::min(in_flight.begin()->first, deadline));
+        size_t completed = 0;
+        while (!in_flight.empty() && in_flight.begin()->first <= std::chrono::steady_clock::now()) {
+            Entry entry = std::move(in_flight.begin()->second);
+            in_flight.erase(in_flight.begin());
+            entry.done(entry.response);
+            completed++;
+        }
+        return completed;
+    }
+
+    size_t pending() const override { return in_flight.size(); }
+
+protected:
+    // Builds the response to `request` and sets how long it takes to "arrive".
+    virtual FetchResponse respond(const FetchRequest& request, uint64_t& delay_micros) = 0;
+
+private:
+    struct Entry {
+        FetchResponse response;
+        Completion done;
+    };
+    std::multimap<std::chrono::steady_clock::time_point, Entry> in_flight; // Ordered by ready time
+};
+
+#endif // FETCHER_HPP
@@ -0,0 +1,105 @@
+#ifndef FRONTIER_SPILL_HPP
+#define FRONTIER_SPILL_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <filesystem>
+#include <stdexcept>
+#include <cstdint>
+#include <atomic>
+#include <algorithm>
+
+// Overflow of the frontier on disk: URLs the memory budget pushed out of the in-memory queue, one
+// per line, read back oldest first. Once everything written has been read back the file is
+// truncated, so it only ever holds what is actually waiting.
+// The monitor spills and refills the queue; workers append the outlinks they find under pressure.
+class FrontierSpill {
+public:
+    explicit FrontierSpill(const std::string& path) : path(path) {
+        out.open(path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Cannot create frontier spill file " + path);
+        }
+    }
+
+    ~FrontierSpill() {
+        out.close();
+        in.close();
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+    }
+
+    FrontierSpill(const FrontierSpill&) = delete;
+    FrontierSpill& operator=(const FrontierSpill&) = delete;
+
+    // Writes `urls` to the end of the file. False if they did not all reach it (disk full, ...): then
+    // none of them count as spilled, and the caller keeps them.
+    bool append(const std::vector<std::string>& urls) {
+        if (urls.empty()) return true;
+        std::lock_guard<std::mutex> lock(mut);
+        std::streampos start = out.tellp();
+        for (const std::string& url : urls) {
+            out << url << '\n';
+        }
+        out.flush();
+        if (!out) {
+            // Whatever part did get written is overwritten by the next append, and never read:
+            // read() takes no more lines than are waiting
+            out.clear();
+            if (start != std::streampos(-1)) out.seekp(start);
+            return false;
+        }
+        waiting += urls.size();
+        spilled += urls.size();
+        return true;
+    }
+
+    // Up to `max` of the oldest spilled URLs.
+    std::vector<std::string> read(size_t max) {
+        std::vector<std::string> urls;
+        std::lock_guard<std::mutex> lock(mut);
+        if (waiting == 0) return urls;
+        if (!in.is_open()) {
+            in.open(path, std::ios::binary);
+        }
+        in.clear(); // Earlier reads may have hit the end before more was appended
+        in.seekg(read_offset);
+        bool at_end = false;
+        std::string line;
+        while (urls.size() < std::min<uint64_t>(max, waiting)) {
+            if (!std::getline(in, line)) {
+                at_end = true;
+                break;
+            }
+            urls.push_back(std::move(line));
+        }
+        read_offset = in.tellg() == std::streampos(-1) ? read_offset : static_cast<uint64_t>(in.tellg());
+        // Hitting the end early means the file lost lines it was counted for: nothing more will
+        // come back, and the crawl must not keep waiting for it
+        waiting -= at_end ? waiting.load() : std::min<uint64_t>(waiting, urls.size());
+        if (waiting == 0) {
+            // Everything is back in memory: start the file over
+            in.close();
+            out.close();
+            out.open(path, std::ios::binary | std::ios::trunc);
+            read_offset = 0;
+        }
+        return urls;
+    }
+
+    uint64_t pending() const { return waiting.load(std::memory_order_relaxed); }       // URLs on disk
+    uint64_t spilled_total() const { return spilled.load(std::memory_order_relaxed); } // URLs ever written
+
+private:
+    const std::string path;
+    std::ofstream out;
+    std::ifstream in;
+    uint64_t read_offset = 0;
+    std::atomic<uint64_t> waiting{0};
+    std::atomic<uint64_t> spilled{0};
+    std::mutex mut; // Mutex to protect the file streams and read_offset
+};
+
+#endif // FRONTIER_SPILL_HPP
@@ -0,0 +1,23 @@
+#ifndef GUMBO_ARENA_HPP
+#define GUMBO_ARENA_HPP
+
+#include <cstddef>
+#include <gumbo.h>
+
+#include "arena.hpp"
+
+// GumboOptions that take every node, attribute and string of the parse tree from `arena` instead
+// of malloc. Freeing is a no-op: the whole tree goes away with the arena's next reset(), so there
+// is no gumbo_destroy_output walk and no free() per node. Do not touch the output after that reset.
+// Everything else (tab stop, error limits, ...) is as in kGumboDefaultOptions.
+inline GumboOptions gumbo_arena_options(Arena& arena) {
+    GumboOptions options = kGumboDefaultOptions;
+    options.allocator = [](void* userdata, size_t size) -> void* {
+        return static_cast<Arena*>(userdata)->allocate(size);
+    };
+    options.deallocator = [](void*, void*) {}; // Released in bulk by Arena::reset()
+    options.userdata = &arena;
+    return options;
+}
+
+#endif // GUMBO_ARENA_HPP
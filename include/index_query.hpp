@@ -0,0 +1,237 @@
+#ifndef INDEX_QUERY_HPP
+#define INDEX_QUERY_HPP
+
+#include <cstdint>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <iterator>
+#include <filesystem>
+
+#include "inverted_index.hpp"
+
+// A query is a disjunction of conjunctions:
+//
+//   apple banana            pages containing both terms
+//   apple OR banana         pages containing either
+//   "apple pie" -recipe     pages containing the phrase but not the term
+//
+// Terms are normalized with the same tokenizer the index builder uses.
+struct QueryClause {
+    std::vector<std::string> terms; // One term, or the terms of a phrase in order
+    bool negated = false;
+};
+
+using QueryConjunction = std::vector<QueryClause>;
+
+inline std::vector<QueryConjunction> parse_query(const std::string& query) {
+    std::vector<QueryConjunction> disjunction(1);
+    size_t i = 0;
+    while (i < query.size()) {
+        if (std::isspace(static_cast<unsigned char>(query[i]))) {
+            ++i;
+            continue;
+        }
+        QueryClause clause;
+        if (query[i] == '-') {
+            clause.negated = true;
+            ++i;
+        }
+        std::string text;
+        if (i < query.size() && query[i] == '"') {
+            size_t close = query.find('"', i + 1);
+            if (close == std::string::npos) close = query.size();
+            text = query.substr(i + 1, close - i - 1);
+            i = close + 1;
+        } else {
+            size_t end = i;
+            while (end < query.size() && !std::isspace(static_cast<unsigned char>(query[end]))) ++end;
+            text = query.substr(i, end - i);
+            i = end;
+            if (text == "OR" && !clause.negated) {
+                if (!disjunction.back().empty()) disjunction.emplace_back();
+                continue;
+            }
+        }
+        tokenize(text, [&](const std::string& term, uint32_t) { clause.terms.push_back(term); });
+        if (!clause.terms.empty()) {
+            disjunction.back().push_back(std::move(clause));
+        }
+    }
+    if (disjunction.back().empty()) disjunction.pop_back();
+    return disjunction;
+}
+
+// Runs queries against every segment of an index directory, each mmap'd in place.
+class IndexSearcher {
+public:
+    explicit IndexSearcher(const std::string& dir) {
+        for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+            if (entry.path().extension() == ".idx") {
+                segments.push_back(std::make_unique<IndexSegment>(entry.path().string()));
+            }
+        }
+    }
+
+    size_t segment_count() const { return segments.size(); }
+    uint64_t document_count() const {
+        uint64_t total = 0;
+        for (const auto& segment : segments) total += segment->num_docs();
+        return total;
+    }
+
+    // Returns the URLs of all matching documents, in doc ID order within each segment.
+    std::vector<std::string> search(const std::string& query) const {
+        std::vector<QueryConjunction> disjunction = parse_query(query);
+        std::vector<std::string> urls;
+        for (const auto& segment : segments) {
+            std::vector<uint64_t> matches;
+            for (const QueryConjunction& conjunction : disjunction) {
+                std::vector<uint64_t> docs = evaluate(*segment, conjunction);
+                std::vector<uint64_t> merged;
+                std::set_union(matches.begin(), matches.end(), docs.begin(), docs.end(), std::back_inserter(merged));
+                matches.swap(merged);
+            }
+            for (uint64_t doc_id : matches) {
+                if (const IndexDocEntry* doc = segment->find_doc(doc_id)) {
+                    urls.push_back(segment->url_of(*doc));
+                }
+            }
+        }
+        return urls;
+    }
+
+private:
+    // A term's posting list, decoded down to doc IDs. The positions stay encoded in the mapping;
+    // `positions[i]` points at the tf varint of docs[i], for phrase checks.
+    struct Postings {
+        std::vector<uint64_t> docs;
+        std::vector<const unsigned char*> positions;
+    };
+
+    static Postings decode(const IndexSegment& segment, const std::string& term) {
+        Postings postings;
+        const IndexTermEntry* entry = segment.find(term);
+        if (!entry) return postings;
+        postings.docs.reserve(entry->doc_freq);
+        postings.positions.reserve(entry->doc_freq);
+        const unsigned char* p = segment.postings_of(*entry);
+        uint64_t doc = 0;
+        for (uint32_t i = 0; i < entry->doc_freq; ++i) {
+            doc += get_varint(p);
+            postings.docs.push_back(doc);
+            postings.positions.push_back(p);
+            uint64_t tf = get_varint(p);
+            for (uint64_t k = 0; k < tf; ++k) get_varint(p);
+        }
+        return postings;
+    }
+
+    static std::vector<uint32_t> positions_at(const unsigned char* p) {
+        uint64_t tf = get_varint(p);
+        std::vector<uint32_t> positions(tf);
+        uint32_t position = 0;
+        for (uint64_t k = 0; k < tf; ++k) {
+            position += static_cast<uint32_t>(get_varint(p));
+            positions[k] = position;
+        }
+        return positions;
+    }
+
+    // First index >= `from` whose value is >= `target`: doubles the step until it overshoots, then
+    // binary searches the last step. Costs O(log gap), so a short list intersected with a long one
+    // touches only a few entries of the long one.
+    static size_t gallop(const std::vector<uint64_t>& docs, size_t from, uint64_t target) {
+        size_t step = 1;
+        size_t hi = from;
+        while (hi < docs.size() && docs[hi] < target) {
+            from = hi + 1;
+            hi += step;
+            step *= 2;
+        }
+        hi = std::min(hi, docs.size());
+        return std::lower_bound(docs.begin() + from, docs.begin() + hi, target) - docs.begin();
+    }
+
+    // Keeps the entries of `candidates` that are also in `docs`.
+    static std::vector<uint64_t> intersect(const std::vector<uint64_t>& candidates, const std::vector<uint64_t>& docs) {
+        std::vector<uint64_t> out;
+        size_t j = 0;
+        for (uint64_t doc : candidates) {
+            j = gallop(docs, j, doc);
+            if (j == docs.size()) break;
+            if (docs[j] == doc) out.push_back(doc);
+        }
+        return out;
+    }
+
+    // Docs of a phrase: intersect the terms' doc lists, then check that the positions line up.
+    static std::vector<uint64_t> phrase_docs(const IndexSegment& segment, const std::vector<std::string>& terms) {
+        std::vector<Postings> lists;
+        for (const std::string& term : terms) {
+            lists.push_back(decode(segment, term));
+            if (lists.back().docs.empty()) return {};
+        }
+        if (lists.size() == 1) return lists[0].docs;
+
+        // Rarest term first keeps the candidate set small
+        std::vector<size_t> order(lists.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return lists[a].docs.size() < lists[b].docs.size(); });
+        std::vector<uint64_t> candidates = lists[order[0]].docs;
+        for (size_t k = 1; k < order.size() && !candidates.empty(); ++k) {
+            candidates = intersect(candidates, lists[order[k]].docs);
+        }
+
+        std::vector<uint64_t> out;
+        for (uint64_t doc : candidates) {
+            // Positions where term i could start the phrase, narrowed term by term
+            std::vector<uint32_t> starts;
+            for (size_t i = 0; i < lists.size(); ++i) {
+                size_t at = std::lower_bound(lists[i].docs.begin(), lists[i].docs.end(), doc) - lists[i].docs.begin();
+                std::vector<uint32_t> positions = positions_at(lists[i].positions[at]);
+                std::vector<uint32_t> shifted;
+                for (uint32_t position : positions) {
+                    if (position >= i) shifted.push_back(position - static_cast<uint32_t>(i));
+                }
+                if (i == 0) {
+                    starts = std::move(shifted);
+                } else {
+                    std::vector<uint32_t> kept;
+                    std::set_intersection(starts.begin(), starts.end(), shifted.begin(), shifted.end(), std::back_inserter(kept));
+                    starts.swap(kept);
+                }
+                if (starts.empty()) break;
+            }
+            if (!starts.empty()) out.push_back(doc);
+        }
+        return out;
+    }
+
+    static std::vector<uint64_t> evaluate(const IndexSegment& segment, const QueryConjunction& conjunction) {
+        std::vector<std::vector<uint64_t>> positive;
+        std::vector<std::vector<uint64_t>> negative;
+        for (const QueryClause& clause : conjunction) {
+            (clause.negated ? negative : positive).push_back(phrase_docs(segment, clause.terms));
+        }
+        if (positive.empty()) return {}; // A purely negative query would match nearly everything
+
+        std::sort(positive.begin(), positive.end(), [](const auto& a, const auto& b) { return a.size() < b.size(); });
+        std::vector<uint64_t> result = positive[0];
+        for (size_t k = 1; k < positive.size() && !result.empty(); ++k) {
+            result = intersect(result, positive[k]);
+        }
+        for (const std::vector<uint64_t>& excluded : negative) {
+            std::vector<uint64_t> kept;
+            std::set_difference(result.begin(), result.end(), excluded.begin(), excluded.end(), std::back_inserter(kept));
+            result.swap(kept);
+        }
+        return result;
+    }
+
+    std::vector<std::unique_ptr<IndexSegment>> segments;
+};
+
+#endif // INDEX_QUERY_HPP
@@ -0,0 +1,600 @@
+#ifndef INVERTED_INDEX_HPP
+#define INVERTED_INDEX_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <map>
+#include <memory>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <filesystem>
+#include <stdexcept>
+#include <cstdlib>
+
+#include "varint.hpp"
+#include "mapped_file.hpp"
+
+// --- Tokenizer ---
+// Splits text into lower-cased ASCII alphanumeric terms and calls f(term, position) for each.
+// Terms longer than MAX_TERM_LENGTH are dropped (they are almost always junk like base64 blobs).
+// The query tool uses the same function, so queries and documents are normalized identically.
+constexpr size_t MAX_TERM_LENGTH = 64;
+
+template <typename F>
+void tokenize(const std::string& text, F&& f) {
+    std::string term;
+    uint32_t position = 0;
+    for (size_t i = 0; i <= text.size(); ++i) {
+        unsigned char c = i < text.size() ? static_cast<unsigned char>(text[i]) : ' ';
+        if (std::isalnum(c)) {
+            term.push_back(static_cast<char>(std::tolower(c)));
+        } else if (!term.empty()) {
+            if (term.size() <= MAX_TERM_LENGTH) {
+                f(term, position++);
+            }
+            term.clear();
+        }
+    }
+}
+
+// --- Segment file layout ---
+// An index segment (<dir>/seg-NNNNNN.idx) is immutable and is used in place through mmap:
+//
+//   IndexSegmentHeader                     64 bytes
+//   IndexTermEntry    terms[num_terms]     sorted by term bytes, for binary search
+//   char              term_bytes[]         the term strings, referenced by the entries
+//   uint8_t           postings[]           one posting list per term
+//   (padding to 8 bytes)
+//   IndexDocEntry     docs[num_docs]       sorted by doc_id
+//   char              url_bytes[]
+//
+// A posting list holds, per document in increasing doc_id order:
+//   varint(doc_id - previous doc_id), varint(tf), tf x varint(position - previous position)
+// (the first doc_id and the first position of each document are stored as is).
+struct IndexSegmentHeader {
+    char magic[8];          // "CRWLIDX1"
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t num_terms;
+    uint64_t num_docs;
+    uint64_t terms_pos;
+    uint64_t term_bytes_pos;
+    uint64_t postings_pos;
+    uint64_t docs_pos;
+};
+static_assert(sizeof(IndexSegmentHeader) == 64, "IndexSegmentHeader must stay 64 bytes");
+
+struct IndexTermEntry {
+    uint64_t term_offset;     // Into term_bytes
+    uint64_t postings_offset; // Into postings
+    uint64_t postings_bytes;
+    uint32_t term_length;
+    uint32_t doc_freq;
+};
+
+struct IndexDocEntry {
+    uint64_t doc_id;
+    uint64_t url_offset;      // Into url_bytes
+    uint32_t url_length;
+    uint32_t length;          // Number of terms in the document
+};
+
+constexpr uint32_t INDEX_SEGMENT_VERSION = 1;
+
+// Read-only view of one segment file. The constructor checks that every section, and every term,
+// posting list and URL the tables point to, lies inside the file, so a truncated or corrupt segment
+// is rejected instead of read past its mapping.
+class IndexSegment {
+public:
+    explicit IndexSegment(const std::string& path) : file(path) {
+        if (file.size() < sizeof(IndexSegmentHeader)) {
+            throw std::runtime_error(path + " is not an index segment");
+        }
+        header = reinterpret_cast<const IndexSegmentHeader*>(file.data());
+        if (std::memcmp(header->magic, "CRWLIDX1", 8) != 0 || header->version != INDEX_SEGMENT_VERSION) {
+            throw std::runtime_error(path + " is not a valid index segment");
+        }
+        // Sections follow one another in file order; the tables must fit between their neighbours
+        const uint64_t size = file.size();
+        const IndexSegmentHeader& h = *header;
+        if (h.terms_pos != sizeof(IndexSegmentHeader) ||
+            h.num_terms > (size - h.terms_pos) / sizeof(IndexTermEntry) ||
+            h.term_bytes_pos != h.terms_pos + h.num_terms * sizeof(IndexTermEntry) ||
+            h.postings_pos < h.term_bytes_pos || h.postings_pos > size ||
+            h.docs_pos < h.postings_pos || h.docs_pos > size || h.docs_pos % alignof(IndexDocEntry) != 0 ||
+            h.num_docs > (size - h.docs_pos) / sizeof(IndexDocEntry)) {
+            throw std::runtime_error(path + " is truncated or corrupt (section bounds)");
+        }
+        const uint64_t term_bytes_size = h.postings_pos - h.term_bytes_pos;
+        const uint64_t postings_size = h.docs_pos - h.postings_pos;
+        const uint64_t url_bytes_pos = h.docs_pos + h.num_docs * sizeof(IndexDocEntry);
+        const uint64_t url_bytes_size = size - url_bytes_pos;
+        auto fits = [](uint64_t offset, uint64_t length, uint64_t section) {
+            return offset <= section && length <= section - offset;
+        };
+        terms = reinterpret_cast<const IndexTermEntry*>(file.data() + header->terms_pos);
+        docs = reinterpret_cast<const IndexDocEntry*>(file.data() + header->docs_pos);
+        for (uint64_t i = 0; i < h.num_terms; ++i) {
+            if (!fits(terms[i].term_offset, terms[i].term_length, term_bytes_size) ||
+                !fits(terms[i].postings_offset, terms[i].postings_bytes, postings_size)) {
+                throw std::runtime_error(path + " is truncated or corrupt (term " + std::to_string(i) + ")");
+            }
+        }
+        for (uint64_t i = 0; i < h.num_docs; ++i) {
+            if (!fits(docs[i].url_offset, docs[i].url_length, url_bytes_size)) {
+                throw std::runtime_error(path + " is truncated or corrupt (document " + std::to_string(i) + ")");
+            }
+        }
+        term_bytes = reinterpret_cast<const char*>(file.data() + header->term_bytes_pos);
+        postings = file.data() + header->postings_pos;
+        url_bytes = reinterpret_cast<const char*>(file.data() + url_bytes_pos);
+    }
+
+    uint64_t num_terms() const { return header->num_terms; }
+    uint64_t num_docs() const { return header->num_docs; }
+
+    std::string term(uint64_t i) const {
+        return std::string(term_bytes + terms[i].term_offset, terms[i].term_length);
+    }
+    const IndexTermEntry& term_entry(uint64_t i) const { return terms[i]; }
+    const unsigned char* postings_of(const IndexTermEntry& entry) const { return postings + entry.postings_offset; }
+
+    // Binary search in the term dictionary. Returns nullptr if the term is not in this segment.
+    const IndexTermEntry* find(const std::string& term) const {
+        uint64_t lo = 0, hi = header->num_terms;
+        while (lo < hi) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            int cmp = compare(mid, term);
+            if (cmp == 0) return &terms[mid];
+            if (cmp < 0) lo = mid + 1; else hi = mid;
+        }
+        return nullptr;
+    }
+
+    const IndexDocEntry& doc(uint64_t i) const { return docs[i]; }
+    std::string url_of(const IndexDocEntry& entry) const {
+        return std::string(url_bytes + entry.url_offset, entry.url_length);
+    }
+
+    // Binary search in the document table. Returns nullptr if doc_id is not in this segment.
+    const IndexDocEntry* find_doc(uint64_t doc_id) const {
+        const IndexDocEntry* end = docs + header->num_docs;
+        const IndexDocEntry* it = std::lower_bound(docs, end, doc_id,
+            [](const IndexDocEntry& entry, uint64_t id) { return entry.doc_id < id; });
+        return it != end && it->doc_id == doc_id ? it : nullptr;
+    }
+
+private:
+    int compare(uint64_t i, const std::string& term) const {
+        size_t len = std::min<size_t>(terms[i].term_length, term.size());
+        int cmp = std::memcmp(term_bytes + terms[i].term_offset, term.data(), len);
+        if (cmp != 0) return cmp;
+        return terms[i].term_length < term.size() ? -1 : (terms[i].term_length > term.size() ? 1 : 0);
+    }
+
+    MappedFile file;
+    const IndexSegmentHeader* header = nullptr;
+    const IndexTermEntry* terms = nullptr;
+    const char* term_bytes = nullptr;
+    const unsigned char* postings = nullptr;
+    const IndexDocEntry* docs = nullptr;
+    const char* url_bytes = nullptr;
+};
+
+// Builds an index while the crawl runs.
+//
+// Each worker owns an IndexWriter::Buffer and adds documents to it without any locking: terms are
+// appended straight into per-term, already-encoded posting lists. When a buffer grows past
+// flush_bytes it is handed (as a whole) to the segment thread, which sorts the terms and writes an
+// immutable segment file. A separate merge thread combines segments once merge_factor of them have
+// piled up, so workers never wait on disk I/O or merging.
+//
+// I/O errors on those threads do not stop the crawl. A segment that cannot be written is lost, and
+// a failed merge stops merging and leaves its inputs live. Either way the error is kept for errors().
+class IndexWriter {
+private:
+    struct TermPostings {
+        std::string bytes;      // Encoded posting list
+        uint64_t last_doc = 0;
+        uint32_t doc_freq = 0;
+    };
+
+    struct MemorySegment {
+        std::unordered_map<std::string, TermPostings> terms;
+        std::vector<std::pair<IndexDocEntry, std::string>> docs; // Entry (offset unset) and URL
+    };
+
+public:
+    class Buffer {
+    public:
+        explicit Buffer(IndexWriter& writer) : writer(writer), segment(std::make_unique<MemorySegment>()) {}
+        ~Buffer() { flush(); }
+
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+
+        // Tokenizes `text` and adds it as a new document for `url`.
+        void add_document(const std::string& url, const std::string& text) {
+            uint64_t doc_id = writer.next_doc_id++;
+
+            // Group this document's positions per term
+            doc_terms.clear();
+            uint32_t length = 0;
+            tokenize(text, [&](const std::string& term, uint32_t position) {
+                doc_terms[term].push_back(position);
+                length = position + 1;
+            });
+
+            for (auto& [term, positions] : doc_terms) {
+                TermPostings& postings = segment->terms[term];
+                size_t before = postings.bytes.size();
+                put_varint(postings.bytes, postings.doc_freq == 0 ? doc_id : doc_id - postings.last_doc);
+                put_varint(postings.bytes, positions.size());
+                uint32_t previous = 0;
+                for (uint32_t position : positions) {
+                    put_varint(postings.bytes, position - previous);
+                    previous = position;
+                }
+                if (postings.doc_freq == 0) {
+                    bytes += term.size() + sizeof(TermPostings);
+                }
+                bytes += postings.bytes.size() - before;
+                postings.last_doc = doc_id;
+                postings.doc_freq++;
+            }
+            IndexDocEntry entry{};
+            entry.doc_id = doc_id;
+            entry.url_length = static_cast<uint32_t>(url.size());
+            entry.length = length;
+            segment->docs.emplace_back(entry, url);
+            bytes += url.size() + sizeof(IndexDocEntry);
+            writer.docs_indexed.fetch_add(1, std::memory_order_relaxed);
+
+            if (bytes >= writer.flush_bytes) {
+                flush();
+            }
+        }
+
+        // Approximate bytes buffered since the last flush.
+        size_t buffered_bytes() const { return bytes; }
+
+        // Hands the buffered documents to the segment thread.
+        void flush() {
+            if (segment->docs.empty()) return;
+            writer.submit(std::move(segment));
+            segment = std::make_unique<MemorySegment>();
+            bytes = 0;
+        }
+
+    private:
+        IndexWriter& writer;
+        std::unique_ptr<MemorySegment> segment;
+        std::unordered_map<std::string, std::vector<uint32_t>> doc_terms; // Reused across documents
+        size_t bytes = 0;
+    };
+
+    IndexWriter(const std::string& dir, size_t flush_bytes = size_t(32) << 20, size_t merge_factor = 8)
+        : dir(dir), flush_bytes(flush_bytes), merge_factor(merge_factor) {
+        std::filesystem::create_directories(dir);
+        resume();
+        segment_thread = std::thread(&IndexWriter::segment_loop, this);
+        merge_thread = std::thread(&IndexWriter::merge_loop, this);
+    }
+
+    ~IndexWriter() {
+        close();
+    }
+
+    IndexWriter(const IndexWriter&) = delete;
+    IndexWriter& operator=(const IndexWriter&) = delete;
+
+    // Writes all submitted buffers, waits for merging to settle and stops the background threads.
+    // All Buffers must have been flushed (destroyed) before this is called.
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            if (stop_requested) return;
+            stop_requested = true;
+        }
+        cond.notify_all();
+        if (segment_thread.joinable()) segment_thread.join();
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            segments_done = true;
+        }
+        cond.notify_all();
+        if (merge_thread.joinable()) merge_thread.join();
+    }
+
+    size_t documents() const { return docs_indexed.load(std::memory_order_relaxed); }
+    size_t segments_written() const { return segments_created.load(std::memory_order_relaxed); }
+    size_t merges_done() const { return merges.load(std::memory_order_relaxed); }
+    size_t live_segments() const {
+        std::lock_guard<std::mutex> lock(mut);
+        return segments.size();
+    }
+    // What went wrong on the segment and merge threads, oldest first. Complete once close() returned.
+    std::vector<std::string> errors() const {
+        std::lock_guard<std::mutex> lock(mut);
+        return failures;
+    }
+
+    // Merges the posting lists and document tables of several segments into a new segment file.
+    static void merge_segments(const std::vector<const IndexSegment*>& inputs, const std::string& path) {
+        // --- Documents: union of all tables, by doc_id ---
+        std::vector<std::pair<IndexDocEntry, std::string>> docs;
+        for (const IndexSegment* segment : inputs) {
+            for (uint64_t i = 0; i < segment->num_docs(); ++i) {
+                docs.emplace_back(segment->doc(i), segment->url_of(segment->doc(i)));
+            }
+        }
+
+        // --- Terms: k-way merge of the sorted dictionaries ---
+        std::vector<uint64_t> cursor(inputs.size(), 0);
+        std::vector<std::pair<std::string, TermPostings>> merged;
+        while (true) {
+            std::string smallest;
+            bool any = false;
+            for (size_t s = 0; s < inputs.size(); ++s) {
+                if (cursor[s] < inputs[s]->num_terms()) {
+                    std::string term = inputs[s]->term(cursor[s]);
+                    if (!any || term < smallest) smallest = term;
+                    any = true;
+                }
+            }
+            if (!any) break;
+
+            // Decode each input's posting list for this term into (doc_id, tf + positions bytes)
+            struct Entry { uint64_t doc; const unsigned char* begin; const unsigned char* end; };
+            std::vector<Entry> entries;
+            for (size_t s = 0; s < inputs.size(); ++s) {
+                if (cursor[s] >= inputs[s]->num_terms() || inputs[s]->term(cursor[s]) != smallest) continue;
+                const IndexTermEntry& entry = inputs[s]->term_entry(cursor[s]);
+                const unsigned char* p = inputs[s]->postings_of(entry);
+                uint64_t doc = 0;
+                for (uint32_t d = 0; d < entry.doc_freq; ++d) {
+                    doc += get_varint(p);
+                    const unsigned char* begin = p;
+                    uint64_t tf = get_varint(p);
+                    for (uint64_t k = 0; k < tf; ++k) get_varint(p);
+                    entries.push_back(Entry{doc, begin, p});
+                }
+                cursor[s]++;
+            }
+            std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.doc < b.doc; });
+
+            TermPostings postings;
+            for (const Entry& entry : entries) {
+                put_varint(postings.bytes, postings.doc_freq == 0 ? entry.doc : entry.doc - postings.last_doc);
+                postings.bytes.append(reinterpret_cast<const char*>(entry.begin), entry.end - entry.begin);
+                postings.last_doc = entry.doc;
+                postings.doc_freq++;
+            }
+            merged.emplace_back(smallest, std::move(postings));
+        }
+        write_segment(path, merged, docs);
+    }
+
+private:
+    void submit(std::unique_ptr<MemorySegment> segment) {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            pending.push_back(std::move(segment));
+        }
+        cond.notify_all();
+    }
+
+    void segment_loop() {
+        while (true) {
+            std::unique_ptr<MemorySegment> segment;
+            {
+                std::unique_lock<std::mutex> lock(mut);
+                cond.wait(lock, [this] { return !pending.empty() || stop_requested; });
+                if (pending.empty()) break;
+                segment = std::move(pending.front());
+                pending.erase(pending.begin());
+            }
+
+            std::vector<std::pair<std::string, TermPostings>> terms;
+            terms.reserve(segment->terms.size());
+            for (auto& [term, postings] : segment->terms) {
+                terms.emplace_back(term, std::move(postings));
+            }
+            std::sort(terms.begin(), terms.end(),
+                      [](const auto& a, const auto& b) { return a.first < b.first; });
+            std::string path = new_segment_path();
+            try {
+                write_segment(path, terms, segment->docs);
+            } catch (const std::exception& e) {
+                record_error(std::string("Segment with ") + std::to_string(segment->docs.size()) +
+                             " documents not written: " + e.what());
+                continue;
+            }
+            segments_created.fetch_add(1, std::memory_order_relaxed);
+
+            {
+                std::lock_guard<std::mutex> lock(mut);
+                segments.push_back(path);
+            }
+            cond.notify_all();
+        }
+    }
+
+    void merge_loop() {
+        while (true) {
+            std::vector<std::string> inputs;
+            {
+                std::unique_lock<std::mutex> lock(mut);
+                cond.wait(lock, [this] { return segments.size() >= merge_factor || segments_done; });
+                if (segments.size() < merge_factor) break; // Done, and nothing left worth merging
+                // Merge the smallest segments, so a large merged segment is not rewritten every round
+                // (one whose size cannot be read sorts last, and fails the merge if it is picked)
+                std::sort(segments.begin(), segments.end(), [](const std::string& a, const std::string& b) {
+                    std::error_code ec;
+                    return std::filesystem::file_size(a, ec) < std::filesystem::file_size(b, ec);
+                });
+                inputs.assign(segments.begin(), segments.begin() + merge_factor);
+            }
+
+            std::string path = new_segment_path();
+            try {
+                std::vector<std::unique_ptr<IndexSegment>> opened;
+                std::vector<const IndexSegment*> views;
+                for (const std::string& input : inputs) {
+                    opened.push_back(std::make_unique<IndexSegment>(input));
+                    views.push_back(opened.back().get());
+                }
+                merge_segments(views, path);
+            } catch (const std::exception& e) {
+                // Merging the same inputs again would fail again: keep them as they are
+                record_error(std::string("Merging stopped: ") + e.what());
+                break;
+            }
+            merges.fetch_add(1, std::memory_order_relaxed);
+
+            {
+                std::lock_guard<std::mutex> lock(mut);
+                for (const std::string& input : inputs) {
+                    segments.erase(std::find(segments.begin(), segments.end(), input));
+                }
+                segments.push_back(path);
+            }
+            for (const std::string& input : inputs) {
+                std::error_code ec;
+                if (!std::filesystem::remove(input, ec) && ec) {
+                    // A later --index run would load its documents a second time
+                    record_error("Cannot remove merged segment " + input + ": " + ec.message());
+                }
+            }
+        }
+    }
+
+    void record_error(const std::string& message) {
+        std::lock_guard<std::mutex> lock(mut);
+        failures.push_back(message);
+    }
+
+    // Picks up the segments an earlier crawl left in `dir`: they stay live (and take part in merges),
+    // and segment numbers and doc IDs continue after the highest ones found, so nothing is overwritten
+    // and no doc ID is handed out twice.
+    void resume() {
+        for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+            std::string name = entry.path().filename().string();
+            if (entry.path().extension() == ".tmp") {
+                std::filesystem::remove(entry.path()); // Left behind by an interrupted write
+                continue;
+            }
+            if (name.size() != 14 || name.rfind("seg-", 0) != 0 || entry.path().extension() != ".idx") continue;
+            IndexSegment segment(entry.path().string());
+            next_segment = std::max<size_t>(next_segment, std::strtoull(name.c_str() + 4, nullptr, 10) + 1);
+            if (segment.num_docs() > 0) {
+                next_doc_id = std::max<uint64_t>(next_doc_id, segment.doc(segment.num_docs() - 1).doc_id + 1);
+            }
+            segments.push_back(entry.path().string());
+        }
+    }
+
+    std::string new_segment_path() {
+        char name[32];
+        std::snprintf(name, sizeof(name), "seg-%06zu.idx", next_segment++);
+        return (std::filesystem::path(dir) / name).string();
+    }
+
+    // Writes a segment to `path` (via a temporary file, so readers never see a partial segment).
+    static void write_segment(const std::string& path,
+                              const std::vector<std::pair<std::string, TermPostings>>& terms,
+                              std::vector<std::pair<IndexDocEntry, std::string>>& docs) {
+        std::sort(docs.begin(), docs.end(),
+                  [](const auto& a, const auto& b) { return a.first.doc_id < b.first.doc_id; });
+
+        std::vector<IndexTermEntry> entries(terms.size());
+        std::string term_bytes;
+        uint64_t postings_bytes = 0;
+        for (size_t i = 0; i < terms.size(); ++i) {
+            entries[i].term_offset = term_bytes.size();
+            entries[i].term_length = static_cast<uint32_t>(terms[i].first.size());
+            entries[i].postings_offset = postings_bytes;
+            entries[i].postings_bytes = terms[i].second.bytes.size();
+            entries[i].doc_freq = terms[i].second.doc_freq;
+            term_bytes += terms[i].first;
+            postings_bytes += terms[i].second.bytes.size();
+        }
+        std::string url_bytes;
+        std::vector<IndexDocEntry> doc_entries(docs.size());
+        for (size_t i = 0; i < docs.size(); ++i) {
+            doc_entries[i] = docs[i].first;
+            doc_entries[i].url_offset = url_bytes.size();
+            doc_entries[i].url_length = static_cast<uint32_t>(docs[i].second.size());
+            url_bytes += docs[i].second;
+        }
+
+        IndexSegmentHeader header{};
+        std::memcpy(header.magic, "CRWLIDX1", 8);
+        header.version = INDEX_SEGMENT_VERSION;
+        header.num_terms = terms.size();
+        header.num_docs = docs.size();
+        header.terms_pos = sizeof(IndexSegmentHeader);
+        header.term_bytes_pos = header.terms_pos + entries.size() * sizeof(IndexTermEntry);
+        header.postings_pos = header.term_bytes_pos + term_bytes.size();
+        header.docs_pos = (header.postings_pos + postings_bytes + 7) & ~uint64_t(7);
+        size_t padding = header.docs_pos - (header.postings_pos + postings_bytes);
+
+        std::string tmp_path = path + ".tmp";
+        std::FILE* out = std::fopen(tmp_path.c_str(), "wb");
+        if (!out) {
+            throw std::runtime_error("Cannot open " + tmp_path);
+        }
+        auto write = [out](const void* data, size_t size, size_t count) {
+            return count == 0 || std::fwrite(data, size, count, out) == count;
+        };
+        bool ok = write(&header, sizeof(header), 1) &&
+                  write(entries.data(), sizeof(IndexTermEntry), entries.size()) &&
+                  write(term_bytes.data(), 1, term_bytes.size());
+        for (size_t i = 0; ok && i < terms.size(); ++i) {
+            ok = write(terms[i].second.bytes.data(), 1, terms[i].second.bytes.size());
+        }
+        static const char zeros[8] = {};
+        ok = ok && write(zeros, 1, padding) &&
+             write(doc_entries.data(), sizeof(IndexDocEntry), doc_entries.size()) &&
+             write(url_bytes.data(), 1, url_bytes.size());
+        ok = std::fclose(out) == 0 && ok;
+        std::error_code ec;
+        if (ok) {
+            std::filesystem::rename(tmp_path, path, ec);
+        }
+        if (!ok || ec) {
+            std::filesystem::remove(tmp_path, ec);
+            throw std::runtime_error("Cannot write " + (ok ? path : tmp_path));
+        }
+    }
+
+    const std::string dir;
+    const size_t flush_bytes;
+    const size_t merge_factor;
+
+    std::atomic<uint64_t> next_doc_id{0};
+    std::atomic<size_t> docs_indexed{0};
+    std::atomic<size_t> segments_created{0};
+    std::atomic<size_t> merges{0};
+    std::atomic<size_t> next_segment{0};
+
+    std::vector<std::unique_ptr<MemorySegment>> pending; // Buffers waiting to be written
+    std::vector<std::string> segments;                   // Live segment files
+    std::vector<std::string> failures;                   // Errors on the background threads
+    bool stop_requested = false;
+    bool segments_done = false;
+    mutable std::mutex mut;       // Mutex to protect pending, segments, failures and the flags
+    std::condition_variable cond; // Wakes the segment and merge threads
+    std::thread segment_thread;
+    std::thread merge_thread;
+};
+
+#endif // INVERTED_INDEX_HPP
@@ -0,0 +1,203 @@
+#ifndef LATENCY_HISTOGRAM_HPP
+#define LATENCY_HISTOGRAM_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <array>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <ostream>
+#include <algorithm>
+
+// HDR-style log-linear histogram of durations in microseconds.
+//
+// Values below SUB_BUCKETS get one bucket each; above that every power of two is split into
+// SUB_BUCKETS equal buckets, so any recorded value is off by at most 1/SUB_BUCKETS (~3%) while
+// covering 1us to ~12 days in about a thousand buckets.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr uint64_t SUB_BUCKETS = uint64_t(1) << SUB_BUCKET_BITS;
+    static constexpr int MAX_VALUE_BITS = 40;
+    static constexpr size_t BUCKETS = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static size_t bucket_of(uint64_t value) {
+        if (value < SUB_BUCKETS) return static_cast<size_t>(value);
+        value = std::min(value, (uint64_t(1) << MAX_VALUE_BITS) - 1);
+        int msb = 63 - count_leading_zeros(value);
+        int shift = msb - SUB_BUCKET_BITS;
+        return static_cast<size_t>((shift + 1) * SUB_BUCKETS + ((value >> shift) - SUB_BUCKETS));
+    }
+
+    // Largest value that falls into `bucket` (reported percentiles err on the high side).
+    static uint64_t bucket_upper(size_t bucket) {
+        if (bucket < SUB_BUCKETS) return bucket;
+        int shift = static_cast<int>(bucket / SUB_BUCKETS) - 1;
+        uint64_t low = (SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+        return low + (uint64_t(1) << shift) - 1;
+    }
+
+    void add(uint64_t value) {
+        counts[bucket_of(value)]++;
+        total++;
+        sum += value;
+        max_value = std::max(max_value, value);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < BUCKETS; ++i) counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        max_value = std::max(max_value, other.max_value);
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return max_value; }
+    double mean() const { return total ? static_cast<double>(sum) / total : 0.0; }
+
+    // Value at or below which `p` percent of the recorded values fall.
+    uint64_t percentile(double p) const {
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * total + 0.5);
+        rank = std::max<uint64_t>(1, std::min(rank, total));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += counts[i];
+            if (seen >= rank) return std::min(bucket_upper(i), max_value);
+        }
+        return max_value;
+    }
+
+    std::array<uint64_t, BUCKETS> counts{};
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t max_value = 0;
+
+private:
+    static int count_leading_zeros(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_clzll(value);
+#else
+        int n = 0;
+        for (uint64_t bit = uint64_t(1) << 63; !(value & bit); bit >>= 1) n++;
+        return n;
+#endif
+    }
+};
+
+// The stages of a page's life that are timed.
+// The curl phases are split into their own durations (curl reports them as times since the start of
+// the transfer): Dns, Connect (TCP), Tls and Ttfb (request sent to first byte) add up to the time to
+// first byte, and Total is the whole transfer including the body.
+// After parsing, Dedup (visible text and the simhash lookup), Index and Extract (link extraction
+// only) are timed separately.
+enum class Stage { QueueWait, Dns, Connect, Tls, Ttfb, Total, Parse, Dedup, Index, Extract, COUNT };
+
+constexpr size_t STAGE_COUNT = static_cast<size_t>(Stage::COUNT);
+
+inline const char* stage_name(Stage stage) {
+    static const char* const names[STAGE_COUNT] = {
+        "queue_wait", "dns", "connect", "tls", "ttfb", "total", "parse", "dedup", "index", "extract"};
+    return names[static_cast<size_t>(stage)];
+}
+
+// Per-thread stage histograms, merged only when someone asks for percentiles.
+//
+// Each thread records into its own Recorder with relaxed atomic stores and no read-modify-write,
+// so recording never contends and never locks. A reader sums all recorders; it may see a
+// value a thread is in the middle of adding (counts and total can briefly disagree by one), which is
+// fine for monitoring. Recorders are owned by the registry, so they outlive the worker threads.
+class StageTimings {
+public:
+    class Recorder {
+    public:
+        void record(Stage stage, uint64_t micros) {
+            Slot& slot = slots[static_cast<size_t>(stage)];
+            bump(slot.counts[LatencyHistogram::bucket_of(micros)], 1);
+            bump(slot.total, 1);
+            bump(slot.sum, micros);
+            if (micros > slot.max_value.load(std::memory_order_relaxed)) {
+                slot.max_value.store(micros, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        friend class StageTimings;
+
+        struct Slot {
+            std::array<std::atomic<uint64_t>, LatencyHistogram::BUCKETS> counts{};
+            std::atomic<uint64_t> total{0};
+            std::atomic<uint64_t> sum{0};
+            std::atomic<uint64_t> max_value{0};
+        };
+
+        // Single writer: a plain load + store is enough, and much cheaper than fetch_add
+        static void bump(std::atomic<uint64_t>& counter, uint64_t amount) {
+            counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        }
+
+        std::array<Slot, STAGE_COUNT> slots;
+    };
+
+    // A recorder for the calling thread. Call once per thread and keep the reference. One released
+    // by a thread that has exited is handed out again: its counts stay and new ones add to them.
+    Recorder& register_thread() {
+        std::lock_guard<std::mutex> lock(mut);
+        if (!free_recorders.empty()) {
+            Recorder* recorder = free_recorders.back();
+            free_recorders.pop_back();
+            return *recorder;
+        }
+        recorders.push_back(std::make_unique<Recorder>());
+        return *recorders.back();
+    }
+
+    // Gives `recorder` back once its thread is done recording, so a pool that keeps replacing
+    // threads does not keep adding recorders.
+    void release_thread(Recorder& recorder) {
+        std::lock_guard<std::mutex> lock(mut);
+        free_recorders.push_back(&recorder);
+    }
+
+    // Snapshot of one stage across all threads.
+    LatencyHistogram merged(Stage stage) const {
+        LatencyHistogram result;
+        std::lock_guard<std::mutex> lock(mut);
+        for (const auto& recorder : recorders) {
+            const Recorder::Slot& slot = recorder->slots[static_cast<size_t>(stage)];
+            for (size_t i = 0; i < LatencyHistogram::BUCKETS; ++i) {
+                result.counts[i] += slot.counts[i].load(std::memory_order_relaxed);
+            }
+            result.total += slot.total.load(std::memory_order_relaxed);
+            result.sum += slot.sum.load(std::memory_order_relaxed);
+            result.max_value = std::max(result.max_value, slot.max_value.load(std::memory_order_relaxed));
+        }
+        return result;
+    }
+
+    void report(std::ostream& os) const {
+        os << "--- Stage Latencies (ms) ---" << std::endl;
+        char line[128];
+        std::snprintf(line, sizeof(line), "  %-12s %10s %9s %9s %9s %9s %9s",
+                      "stage", "count", "mean", "p50", "p90", "p99", "max");
+        os << line << std::endl;
+        for (size_t s = 0; s < STAGE_COUNT; ++s) {
+            LatencyHistogram h = merged(static_cast<Stage>(s));
+            if (h.count() == 0) continue;
+            std::snprintf(line, sizeof(line), "  %-12s %10llu %9.2f %9.2f %9.2f %9.2f %9.2f",
+                          stage_name(static_cast<Stage>(s)), static_cast<unsigned long long>(h.count()),
+                          h.mean() / 1000.0, h.percentile(50) / 1000.0, h.percentile(90) / 1000.0,
+                          h.percentile(99) / 1000.0, h.max() / 1000.0);
+            os << line << std::endl;
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<Recorder>> recorders;
+    std::vector<Recorder*> free_recorders; // Released by exited threads, waiting for the next one
+    mutable std::mutex mut; // Mutex to protect recorders and free_recorders (taken on registration and merge only)
+};
+
+#endif // LATENCY_HISTOGRAM_HPP
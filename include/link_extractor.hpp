@@ -0,0 +1,175 @@
+#ifndef LINK_EXTRACTOR_HPP
+#define LINK_EXTRACTOR_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstring>
+#include <gumbo.h>
+
+#include "arena.hpp"
+
+// Link extraction from a parsed page: the worker resolves every <a href> against the page URL (or
+// its <base href>). Kept in a header so crawler_microbench can measure it without the crawler.
+
+// --- URL Resolution Helper ---
+// Basic function to convert relative URLs to absolute URLs
+// A robust crawler needs a much more complex version of this!
+//
+// Every case below comes out as a piece of the base URL, an optional "/" and the relative URL, so
+// the resolution only records where those pieces are; the callers then build the URL in one go,
+// either in a std::string or in a worker's Arena.
+struct ResolvedUrl {
+    bool valid = false;
+    std::string_view prefix;    // Leading part of the base URL
+    std::string_view separator; // "" or "/"
+    std::string_view relative;
+
+    size_t size() const { return prefix.size() + separator.size() + relative.size(); }
+};
+
+inline ResolvedUrl resolve_url_parts(std::string_view base_url, std::string_view relative_url) {
+    ResolvedUrl resolved;
+    // Very basic checks - skip javascript, mailto, anchors, etc.
+    if (relative_url.rfind("javascript:", 0) == 0 ||
+        relative_url.rfind("mailto:", 0) == 0 ||
+        relative_url.find('#') != std::string_view::npos) {
+        return resolved; // Ignore these types of links
+    }
+    resolved.relative = relative_url;
+
+    // If it's already an absolute URL
+    if (relative_url.rfind("http://", 0) == 0 || relative_url.rfind("https://", 0) == 0) {
+        resolved.valid = true;
+        return resolved;
+    }
+
+    // If it starts with "//" (protocol-relative)
+    if (relative_url.rfind("//", 0) == 0) {
+        // Find protocol of base URL
+        size_t proto_end = base_url.find(':');
+        if (proto_end != std::string_view::npos) {
+            resolved.prefix = base_url.substr(0, proto_end + 1);
+            resolved.valid = true;
+        }
+        return resolved; // Invalid if we cannot determine the protocol
+    }
+
+    // If it starts with "/" (relative to root)
+    if (relative_url.rfind("/", 0) == 0) {
+        // Find the end of the domain part of the base URL
+        // Example: https://www.example.com/some/path -> https://www.example.com
+        size_t protocol_pos = base_url.find("//");
+        if (protocol_pos == std::string_view::npos) {
+             return resolved; // Invalid base URL?
+        }
+        // Base URL might just be the domain (e.g., https://example.com); substr then keeps all of it
+        size_t domain_end = base_url.find('/', protocol_pos + 2);
+        resolved.prefix = base_url.substr(0, domain_end);
+        resolved.valid = true;
+        return resolved;
+    }
+
+    // Otherwise, it's relative to the current path (e.g., "otherpage.html")
+    size_t last_slash = base_url.rfind('/');
+    // Make sure it's after the protocol part "https://" (index > 7)
+    if (last_slash != std::string_view::npos && last_slash > 7) {
+        resolved.prefix = base_url.substr(0, last_slash + 1);
+    } else {
+         // Base URL might not have a path (e.g., https://example.com)
+        resolved.prefix = base_url;
+        resolved.separator = "/";
+    }
+    resolved.valid = true;
+    return resolved;
+     // A production crawler needs a proper URL parsing library (like Boost.URL) for robust handling!
+}
+
+// The resolved URL as a string, or "" if the link is not worth following.
+inline std::string resolve_url(const std::string& base_url, const std::string& relative_url) {
+    ResolvedUrl resolved = resolve_url_parts(base_url, relative_url);
+    std::string url;
+    if (!resolved.valid) return url;
+    url.reserve(resolved.size());
+    url.append(resolved.prefix).append(resolved.separator).append(resolved.relative);
+    return url;
+}
+
+// The same, built in `arena` (valid until its next reset()); empty if not worth following.
+inline std::string_view resolve_url(Arena& arena, std::string_view base_url, std::string_view relative_url) {
+    ResolvedUrl resolved = resolve_url_parts(base_url, relative_url);
+    if (!resolved.valid) return {};
+    char* out = arena.allocate_chars(resolved.size());
+    std::memcpy(out, resolved.prefix.data(), resolved.prefix.size());
+    std::memcpy(out + resolved.prefix.size(), resolved.separator.data(), resolved.separator.size());
+    std::memcpy(out + resolved.prefix.size() + resolved.separator.size(), resolved.relative.data(), resolved.relative.size());
+    return {out, resolved.size()};
+}
+
+// --- Gumbo Parser (Modified to resolve relative URLs) ---
+// We now need the base URL to correctly handle relative links like "/about"
+inline void search_for_links(GumboNode* node, std::vector<std::string>& links, const std::string& base_url) {
+    if (node->type != GUMBO_NODE_ELEMENT) return;
+
+    if (node->v.element.tag == GUMBO_TAG_A) {
+        GumboAttribute* href = gumbo_get_attribute(&node->v.element.attributes, "href");
+        if (href && href->value && href->value[0] != '\0') { // Check if href exists and is not empty
+             // NEW: Resolve relative URLs (like "/about") into absolute URLs
+             std::string resolved = resolve_url(base_url, href->value);
+             if (!resolved.empty()) { // Only add valid, resolved URLs
+                links.push_back(resolved);
+             }
+        }
+    }
+
+    GumboVector* children = &node->v.element.children;
+    for (unsigned int i = 0; i < children->length; ++i) {
+        search_for_links(static_cast<GumboNode*>(children->data[i]), links, base_url);
+    }
+}
+
+// The worker's version: the links are resolved into `arena` and `links` only holds views of them,
+// so with a reused vector and an arena that is reset per page, extraction does no per-link malloc.
+// The views stay valid after the Gumbo tree is destroyed, until the arena is reset.
+inline void search_for_links(GumboNode* node, Arena& arena, std::vector<std::string_view>& links, std::string_view base_url) {
+    if (node->type != GUMBO_NODE_ELEMENT) return;
+
+    if (node->v.element.tag == GUMBO_TAG_A) {
+        GumboAttribute* href = gumbo_get_attribute(&node->v.element.attributes, "href");
+        if (href && href->value && href->value[0] != '\0') {
+            std::string_view resolved = resolve_url(arena, base_url, href->value);
+            if (!resolved.empty()) {
+                links.push_back(resolved);
+            }
+        }
+    }
+
+    GumboVector* children = &node->v.element.children;
+    for (unsigned int i = 0; i < children->length; ++i) {
+        search_for_links(static_cast<GumboNode*>(children->data[i]), arena, links, base_url);
+    }
+}
+
+// --- <base href> Lookup ---
+// Returns the href of the first <base> element in the document, or "" if there is none.
+inline std::string find_base_href(GumboNode* node) {
+    if (node->type != GUMBO_NODE_ELEMENT) return "";
+
+    if (node->v.element.tag == GUMBO_TAG_BASE) {
+        GumboAttribute* href = gumbo_get_attribute(&node->v.element.attributes, "href");
+        if (href && href->value && href->value[0] != '\0') {
+            return href->value;
+        }
+    }
+
+    GumboVector* children = &node->v.element.children;
+    for (unsigned int i = 0; i < children->length; ++i) {
+        std::string found = find_base_href(static_cast<GumboNode*>(children->data[i]));
+        if (!found.empty()) {
+            return found;
+        }
+    }
+    return "";
+}
+
+#endif // LINK_EXTRACTOR_HPP
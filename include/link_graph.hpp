@@ -0,0 +1,303 @@
+#ifndef LINK_GRAPH_HPP
+#define LINK_GRAPH_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+
+#include "content_hash.hpp"
+#include "varint.hpp"
+#include "mapped_file.hpp"
+
+// On-disk layout of a link graph file (<prefix>.graph), all integers little-endian:
+//
+//   LinkGraphHeader                       64 bytes
+//   uint64_t offsets[num_nodes + 1]       byte offset of each node's adjacency list in the data section
+//   uint8_t  data[data_bytes]             adjacency lists
+//
+// Each adjacency list is varint(degree) followed by the sorted target IDs, the first one as is and
+// every later one as the gap to its predecessor, all as varints. Node IDs are dense (0..num_nodes-1)
+// and the i-th line of <prefix>.urls is the URL of node i. The offsets array is 8-byte aligned, so
+// the file can be mmap'd and used in place.
+struct LinkGraphHeader {
+    char magic[8];          // "CRWLGRPH"
+    uint32_t version;       // LINK_GRAPH_VERSION
+    uint32_t reserved;
+    uint64_t num_nodes;
+    uint64_t num_edges;
+    uint64_t offsets_pos;   // File offset of the offsets array
+    uint64_t data_pos;      // File offset of the data section
+    uint64_t data_bytes;
+    uint64_t padding;
+};
+static_assert(sizeof(LinkGraphHeader) == 64, "LinkGraphHeader must stay 64 bytes");
+
+constexpr uint32_t LINK_GRAPH_VERSION = 1;
+
+// Collects the link graph while the crawl runs.
+// URL -> ID mapping is split over independently locked shards. A worker gathers its edges in a
+// private Buffer that names URLs by buffer-local index (no locking at all); when the buffer flushes,
+// its distinct URLs are resolved to global IDs shard by shard, one lock per shard and flush, and the
+// edges are moved into the graph in one chunk.
+class LinkGraph {
+private:
+    struct Adjacency {
+        uint32_t source;
+        std::vector<uint32_t> targets;
+    };
+
+public:
+    // A worker's private edge buffer. Flushes into the graph when full and when destroyed.
+    class Buffer {
+    public:
+        explicit Buffer(LinkGraph& graph) : graph(graph) {}
+        ~Buffer() { flush(); }
+
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+
+        // Records the outgoing links of `source`.
+        void add_page(const std::string& source, const std::vector<std::string>& targets) {
+            Adjacency adjacency;
+            adjacency.source = local_id(source);
+            adjacency.targets.reserve(targets.size());
+            for (const std::string& target : targets) {
+                adjacency.targets.push_back(local_id(target));
+            }
+            buffered_edges += adjacency.targets.size();
+            pages.push_back(std::move(adjacency));
+            if (buffered_edges >= FLUSH_EDGES) {
+                flush();
+            }
+        }
+
+        void flush() {
+            if (pages.empty()) return;
+
+            // --- Resolve the buffered URLs, grouped so each shard is locked once ---
+            std::array<std::vector<uint32_t>, 1 << SHARD_BITS> by_shard;
+            for (uint32_t local = 0; local < urls.size(); ++local) {
+                by_shard[shard_of(urls[local])].push_back(local);
+            }
+            std::vector<uint32_t> ids(urls.size());
+            for (size_t s = 0; s < by_shard.size(); ++s) {
+                if (by_shard[s].empty()) continue;
+                Shard& shard = graph.shards[s];
+                std::lock_guard<std::mutex> lock(shard.mut);
+                for (uint32_t local : by_shard[s]) {
+                    ids[local] = graph.intern(shard, urls[local]);
+                }
+            }
+
+            for (Adjacency& adjacency : pages) {
+                adjacency.source = ids[adjacency.source];
+                for (uint32_t& target : adjacency.targets) target = ids[target];
+            }
+            {
+                std::lock_guard<std::mutex> lock(graph.adjacency_mut);
+                for (Adjacency& adjacency : pages) {
+                    graph.adjacency.push_back(std::move(adjacency));
+                }
+            }
+            pages.clear();
+            urls.clear();
+            local_ids.clear();
+            buffered_edges = 0;
+        }
+
+    private:
+        static constexpr size_t FLUSH_EDGES = 64 * 1024;
+
+        // Index of `url` in this buffer's URL list, appending it on first sight.
+        uint32_t local_id(std::string_view url) {
+            key.assign(url.data(), url.size()); // Reused, so looking up a known URL does not allocate
+            auto it = local_ids.find(key);
+            if (it != local_ids.end()) return it->second;
+            uint32_t local = static_cast<uint32_t>(urls.size());
+            urls.push_back(key);
+            local_ids.emplace(key, local);
+            return local;
+        }
+
+        LinkGraph& graph;
+        std::vector<Adjacency> pages;          // Sources and targets are indices into urls
+        std::vector<std::string> urls;         // Distinct URLs since the last flush
+        std::unordered_map<std::string, uint32_t> local_ids;
+        std::string key;
+        size_t buffered_edges = 0;
+    };
+
+    // Returns the dense ID of `url`, assigning the next free one on first sight.
+    uint32_t id_of(std::string url) {
+        Shard& shard = shards[shard_of(url)];
+        std::lock_guard<std::mutex> lock(shard.mut);
+        return intern(shard, url);
+    }
+
+    size_t node_count() const { return next_id.load(std::memory_order_relaxed); }
+
+    // Writes <prefix>.graph and <prefix>.urls. Call once all Buffers have been flushed.
+    // Returns the number of edges written.
+    uint64_t write(const std::string& prefix) {
+        uint64_t num_nodes = next_id.load();
+
+        // --- Collapse per-page adjacency into one sorted, de-duplicated list per node ---
+        std::vector<std::vector<uint32_t>> lists(num_nodes);
+        {
+            std::lock_guard<std::mutex> lock(adjacency_mut);
+            for (Adjacency& adjacency : this->adjacency) {
+                std::vector<uint32_t>& list = lists[adjacency.source];
+                list.insert(list.end(), adjacency.targets.begin(), adjacency.targets.end());
+            }
+            this->adjacency.clear();
+        }
+
+        std::string data;
+        std::vector<uint64_t> offsets(num_nodes + 1);
+        uint64_t num_edges = 0;
+        for (uint64_t node = 0; node < num_nodes; ++node) {
+            std::vector<uint32_t>& list = lists[node];
+            std::sort(list.begin(), list.end());
+            list.erase(std::unique(list.begin(), list.end()), list.end());
+
+            offsets[node] = data.size();
+            put_varint(data, list.size());
+            uint32_t previous = 0;
+            for (uint32_t target : list) {
+                put_varint(data, target - previous);
+                previous = target;
+            }
+            num_edges += list.size();
+            std::vector<uint32_t>().swap(list); // Release as we go; large crawls have large graphs
+        }
+        offsets[num_nodes] = data.size();
+
+        LinkGraphHeader header{};
+        std::memcpy(header.magic, "CRWLGRPH", 8);
+        header.version = LINK_GRAPH_VERSION;
+        header.num_nodes = num_nodes;
+        header.num_edges = num_edges;
+        header.offsets_pos = sizeof(LinkGraphHeader);
+        header.data_pos = header.offsets_pos + offsets.size() * sizeof(uint64_t);
+        header.data_bytes = data.size();
+
+        std::string graph_path = prefix + ".graph";
+        std::FILE* out = std::fopen(graph_path.c_str(), "wb");
+        if (!out) {
+            throw std::runtime_error("Cannot open " + graph_path);
+        }
+        std::fwrite(&header, sizeof(header), 1, out);
+        std::fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), out);
+        std::fwrite(data.data(), 1, data.size(), out);
+        std::fclose(out);
+
+        // --- URL table: line i is the URL of node i ---
+        std::vector<const std::string*> urls(num_nodes);
+        for (Shard& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mut);
+            for (const auto& [url, id] : shard.ids) {
+                urls[id] = &url;
+            }
+        }
+        std::string urls_path = prefix + ".urls";
+        out = std::fopen(urls_path.c_str(), "wb");
+        if (!out) {
+            throw std::runtime_error("Cannot open " + urls_path);
+        }
+        for (const std::string* url : urls) {
+            for (char c : *url) {
+                // Keep one URL per line even if an href contained a raw line break
+                if (c == '\n' || c == '\r') {
+                    std::fputs(c == '\n' ? "%0A" : "%0D", out);
+                } else {
+                    std::fputc(c, out);
+                }
+            }
+            std::fputc('\n', out);
+        }
+        std::fclose(out);
+        return num_edges;
+    }
+
+private:
+    static constexpr int SHARD_BITS = 6;
+
+    struct Shard {
+        std::unordered_map<std::string, uint32_t> ids;
+        std::mutex mut; // Mutex to protect this shard
+    };
+
+    static size_t shard_of(const std::string& url) { return content_hash(url) >> (64 - SHARD_BITS); }
+
+    // ID of `url` in `shard`, whose mutex the caller holds. A new URL is moved into the shard.
+    uint32_t intern(Shard& shard, std::string& url) {
+        auto it = shard.ids.find(url);
+        if (it != shard.ids.end()) {
+            return it->second;
+        }
+        uint32_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+        shard.ids.emplace(std::move(url), id);
+        return id;
+    }
+
+    std::array<Shard, 1 << SHARD_BITS> shards;
+    std::atomic<uint32_t> next_id{0};
+
+    std::vector<Adjacency> adjacency;
+    std::mutex adjacency_mut; // Mutex to protect adjacency
+};
+
+// Read-only access to a link graph file, mmap'd and decoded on the fly.
+class LinkGraphView {
+public:
+    explicit LinkGraphView(const std::string& path) : file(path) {
+        if (file.size() < sizeof(LinkGraphHeader)) {
+            throw std::runtime_error(path + " is not a link graph file");
+        }
+        header = reinterpret_cast<const LinkGraphHeader*>(file.data());
+        if (std::memcmp(header->magic, "CRWLGRPH", 8) != 0 || header->version != LINK_GRAPH_VERSION ||
+            header->data_pos + header->data_bytes > file.size() ||
+            header->offsets_pos + (header->num_nodes + 1) * sizeof(uint64_t) > header->data_pos) {
+            throw std::runtime_error(path + " is not a valid link graph file");
+        }
+        offsets = reinterpret_cast<const uint64_t*>(file.data() + header->offsets_pos);
+        data = file.data() + header->data_pos;
+    }
+
+    uint64_t num_nodes() const { return header->num_nodes; }
+    uint64_t num_edges() const { return header->num_edges; }
+
+    uint64_t degree(uint64_t node) const {
+        const unsigned char* p = data + offsets[node];
+        return get_varint(p);
+    }
+
+    // Calls f(target) for every outgoing edge of `node`, in increasing target order.
+    template <typename F>
+    void for_each_neighbor(uint64_t node, F&& f) const {
+        const unsigned char* p = data + offsets[node];
+        uint64_t count = get_varint(p);
+        uint64_t target = 0;
+        for (uint64_t i = 0; i < count; ++i) {
+            target += get_varint(p);
+            f(static_cast<uint32_t>(target));
+        }
+    }
+
+private:
+    MappedFile file;
+    const LinkGraphHeader* header = nullptr;
+    const uint64_t* offsets = nullptr;
+    const unsigned char* data = nullptr;
+};
+
+#endif // LINK_GRAPH_HPP
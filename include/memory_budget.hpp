@@ -0,0 +1,144 @@
+#ifndef MEMORY_BUDGET_HPP
+#define MEMORY_BUDGET_HPP
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <ostream>
+#include <iomanip>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+// Bytes one account holds. Containers and workers add and subtract as they grow and shrink.
+class MemoryAccount {
+public:
+    void add(int64_t amount) {
+        int64_t now = bytes.fetch_add(amount, std::memory_order_relaxed) + amount;
+        int64_t high = peak.load(std::memory_order_relaxed);
+        while (now > high && !peak.compare_exchange_weak(high, now, std::memory_order_relaxed)) {}
+    }
+    void sub(int64_t amount) { bytes.fetch_sub(amount, std::memory_order_relaxed); }
+
+    int64_t used() const { return std::max<int64_t>(0, bytes.load(std::memory_order_relaxed)); }
+    int64_t peak_used() const { return peak.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> bytes{0};
+    std::atomic<int64_t> peak{0};
+};
+
+// Charges `amount` bytes to an account for as long as it lives (a response body, a parse tree).
+class MemoryCharge {
+public:
+    MemoryCharge(MemoryAccount& account, int64_t amount) : account(account), amount(amount) {
+        account.add(amount);
+    }
+    ~MemoryCharge() { account.sub(amount); }
+
+    MemoryCharge(const MemoryCharge&) = delete;
+    MemoryCharge& operator=(const MemoryCharge&) = delete;
+
+private:
+    MemoryAccount& account;
+    const int64_t amount;
+};
+
+// Estimated heap footprint of a container element: the object itself plus what it owns.
+template <typename T>
+inline size_t memory_footprint(const T&) { return sizeof(T); }
+
+inline size_t memory_footprint(const std::string& text) {
+    // Short strings live inside the object (libstdc++ and libc++ both keep 15+ chars inline)
+    return sizeof(std::string) + (text.capacity() > 15 ? text.capacity() + 1 : 0);
+}
+
+enum class MemoryComponent { Frontier, Visited, Responses, ParseTrees, IndexBuffers, COUNT };
+
+constexpr size_t MEMORY_COMPONENT_COUNT = static_cast<size_t>(MemoryComponent::COUNT);
+
+inline const char* memory_component_name(MemoryComponent component) {
+    static const char* const names[MEMORY_COMPONENT_COUNT] = {
+        "frontier", "visited", "responses", "parse_trees", "index_buffers"};
+    return names[static_cast<size_t>(component)];
+}
+
+// The crawl's memory budget: every large consumer reports into its account, and the sum is
+// compared against the limit.
+//
+//   Normal        below SOFT_LIMIT of the budget.
+//   Backpressure  from SOFT_LIMIT: workers send their outlinks to disk (FrontierSpill) instead of
+//                 the frontier and hand their index buffers off early, so the frontier and
+//                 per-worker buffers stop growing.
+//   Spill         from HARD_LIMIT: the frontier itself moves to disk until usage is back under the
+//                 soft limit.
+//
+// Only the components that shrink again (see shrinks()) are measured against the thresholds, and
+// against what the others leave of the budget: the visited set only grows, and no amount of
+// backpressure or spilling would bring a crawl back to Normal once it filled the budget. That share
+// never drops below MIN_WORKING_SHARE, so a visited set past the budget leaves the crawl working
+// from a small frontier rather than stuck at Spill.
+//
+// The accounts are estimates of the big allocations, not a malloc hook, so leave headroom: a budget
+// of 80% of the memory the crawl may use is a good start. Without a limit (0) usage is still
+// tracked and reported, and pressure is always Normal.
+class MemoryBudget {
+public:
+    enum class Pressure { Normal, Backpressure, Spill };
+
+    static constexpr double SOFT_LIMIT = 0.80;
+    static constexpr double HARD_LIMIT = 0.95;
+    static constexpr double MIN_WORKING_SHARE = 0.20; // Of the budget, kept for the shrinking components
+
+    // Whether a component gives memory back under pressure. The visited set only ever grows.
+    static bool shrinks(MemoryComponent component) { return component != MemoryComponent::Visited; }
+
+    void set_limit(uint64_t bytes) { limit.store(bytes, std::memory_order_relaxed); }
+    uint64_t limit_bytes() const { return limit.load(std::memory_order_relaxed); }
+
+    MemoryAccount& account(MemoryComponent component) { return accounts[static_cast<size_t>(component)]; }
+    const MemoryAccount& account(MemoryComponent component) const { return accounts[static_cast<size_t>(component)]; }
+
+    uint64_t used() const {
+        int64_t total = 0;
+        for (const MemoryAccount& account : accounts) total += account.used();
+        return static_cast<uint64_t>(total);
+    }
+
+    Pressure pressure() const {
+        uint64_t budget = limit_bytes();
+        if (budget == 0) return Pressure::Normal;
+        int64_t growing = 0;
+        int64_t shrinking = 0;
+        for (size_t c = 0; c < MEMORY_COMPONENT_COUNT; ++c) {
+            (shrinks(static_cast<MemoryComponent>(c)) ? shrinking : growing) += accounts[c].used();
+        }
+        double room = std::max(static_cast<double>(budget) - static_cast<double>(growing), budget * MIN_WORKING_SHARE);
+        if (shrinking >= room * HARD_LIMIT) return Pressure::Spill;
+        if (shrinking >= room * SOFT_LIMIT) return Pressure::Backpressure;
+        return Pressure::Normal;
+    }
+
+    static const char* pressure_name(Pressure pressure) {
+        static const char* const names[] = {"normal", "backpressure", "spill"};
+        return names[static_cast<int>(pressure)];
+    }
+
+    void report(std::ostream& out) const {
+        out << "--- Memory (estimated) ---" << std::endl << std::fixed << std::setprecision(1);
+        for (size_t c = 0; c < MEMORY_COMPONENT_COUNT; ++c) {
+            out << "  " << memory_component_name(static_cast<MemoryComponent>(c)) << ": "
+                << accounts[c].used() / (1024.0 * 1024.0) << " MB now, "
+                << accounts[c].peak_used() / (1024.0 * 1024.0) << " MB peak" << std::endl;
+        }
+        if (uint64_t budget = limit_bytes()) {
+            out << "  budget: " << budget / (1024.0 * 1024.0) << " MB" << std::endl;
+        }
+    }
+
+private:
+    std::array<MemoryAccount, MEMORY_COMPONENT_COUNT> accounts;
+    std::atomic<uint64_t> limit{0};
+};
+
+#endif // MEMORY_BUDGET_HPP
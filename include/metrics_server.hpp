@@ -0,0 +1,234 @@
+#ifndef METRICS_SERVER_HPP
+#define METRICS_SERVER_HPP
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "latency_histogram.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+// Builds a response body in the Prometheus text exposition format (version 0.0.4).
+class MetricsText {
+public:
+    // `labels` is either empty or a ready-made label set such as {host="example.com"}
+    void counter(const std::string& name, const std::string& help, double value, const std::string& labels = "") {
+        family(name, help, "counter");
+        sample(name, labels, value);
+    }
+
+    void gauge(const std::string& name, const std::string& help, double value, const std::string& labels = "") {
+        family(name, help, "gauge");
+        sample(name, labels, value);
+    }
+
+    // Exposes a microsecond LatencyHistogram as a histogram in seconds with the given bucket bounds.
+    void histogram(const std::string& name, const std::string& help, const LatencyHistogram& h,
+                   const std::vector<double>& bounds_seconds, const std::string& label = "") {
+        family(name, help, "histogram");
+        std::string prefix = label.empty() ? "" : label + ",";
+        for (double bound : bounds_seconds) {
+            uint64_t limit = static_cast<uint64_t>(bound * 1e6);
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i < LatencyHistogram::BUCKETS && LatencyHistogram::bucket_upper(i) <= limit; ++i) {
+                cumulative += h.counts[i];
+            }
+            char le[32];
+            std::snprintf(le, sizeof(le), "%g", bound);
+            sample(name + "_bucket", "{" + prefix + "le=\"" + le + "\"}", static_cast<double>(cumulative));
+        }
+        sample(name + "_bucket", "{" + prefix + "le=\"+Inf\"}", static_cast<double>(h.count()));
+        std::string labels = label.empty() ? "" : "{" + label + "}";
+        sample(name + "_sum", labels, h.sum / 1e6);
+        sample(name + "_count", labels, static_cast<double>(h.count()));
+    }
+
+    // Escapes a label value (backslash, double quote and line feed).
+    static std::string escape(const std::string& value) {
+        std::string out;
+        for (char c : value) {
+            if (c == '\\' || c == '"') out += '\\';
+            if (c == '\n') { out += "\\n"; continue; }
+            out += c;
+        }
+        return out;
+    }
+
+    const std::string& str() const { return text; }
+
+private:
+    // HELP and TYPE are written once per metric family, however many labelled samples follow
+    void family(const std::string& name, const std::string& help, const char* type) {
+        if (name == last_family) return;
+        last_family = name;
+        text += "# HELP " + name + " " + help + "\n";
+        text += "# TYPE " + name + " " + type + "\n";
+    }
+
+    void sample(const std::string& name, const std::string& labels, double value) {
+        char number[32];
+        std::snprintf(number, sizeof(number), "%.17g", value);
+        text += name + labels + " " + number + "\n";
+    }
+
+    std::string text;
+    std::string last_family;
+};
+
+// A minimal HTTP/1.0 server for metrics scrapes, on 127.0.0.1:<port> or on a Unix domain socket.
+// It runs on its own thread and answers every GET with whatever `render` returns, so the cost of a
+// scrape is whatever `render` reads; the crawler's render only reads atomics and its own locks.
+class MetricsServer {
+public:
+    // Listens on 127.0.0.1:port (socket_path empty) or on the Unix socket socket_path (POSIX only).
+    MetricsServer(int port, const std::string& socket_path, std::function<std::string()> render)
+        : render(std::move(render)), socket_path(socket_path) {
+#ifdef _WIN32
+        WSADATA wsa;
+        WSAStartup(MAKEWORD(2, 2), &wsa);
+        if (!socket_path.empty()) {
+            throw std::runtime_error("Unix socket metrics are not supported on Windows");
+        }
+#endif
+        if (socket_path.empty()) {
+            listener = ::socket(AF_INET, SOCK_STREAM, 0);
+            int yes = 1;
+            setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&yes), sizeof(yes));
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(static_cast<unsigned short>(port));
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // Local scrapers only
+            if (::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+                close_socket(listener);
+                throw std::runtime_error("Cannot bind metrics port " + std::to_string(port));
+            }
+        } else {
+#ifndef _WIN32
+            listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+            ::unlink(socket_path.c_str()); // Left behind by an earlier run
+            if (::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+                close_socket(listener);
+                throw std::runtime_error("Cannot bind metrics socket " + socket_path);
+            }
+#endif
+        }
+        ::listen(listener, 16);
+        server = std::thread(&MetricsServer::serve, this);
+    }
+
+    ~MetricsServer() {
+        stop_requested = true;
+        if (server.joinable()) server.join();
+        close_socket(listener);
+#ifdef _WIN32
+        WSACleanup();
+#else
+        if (!socket_path.empty()) ::unlink(socket_path.c_str());
+#endif
+    }
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+private:
+#ifdef MSG_NOSIGNAL
+    static constexpr int SEND_FLAGS = MSG_NOSIGNAL; // A scraper hanging up must not SIGPIPE the crawler
+#else
+    static constexpr int SEND_FLAGS = 0;
+#endif
+#ifdef _WIN32
+    using Socket = SOCKET;
+    static void close_socket(Socket s) { closesocket(s); }
+#else
+    using Socket = int;
+    static void close_socket(Socket s) { ::close(s); }
+#endif
+
+    // Waits up to timeout_ms for `s` to become readable.
+    static bool readable(Socket s, int timeout_ms) {
+#ifdef _WIN32
+        fd_set set;
+        FD_ZERO(&set);
+        FD_SET(s, &set);
+        timeval tv{timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+        return select(0, &set, nullptr, nullptr, &tv) > 0;
+#else
+        pollfd pfd{s, POLLIN, 0};
+        return ::poll(&pfd, 1, timeout_ms) > 0;
+#endif
+    }
+
+    void serve() {
+        while (!stop_requested) {
+            if (!readable(listener, 200)) continue; // Re-check stop_requested 5 times a second
+            Socket client = ::accept(listener, nullptr, nullptr);
+#ifdef _WIN32
+            if (client == INVALID_SOCKET) continue;
+#else
+            if (client < 0) continue;
+#endif
+            handle(client);
+            close_socket(client);
+        }
+    }
+
+    void handle(Socket client) {
+        // Read the request head; only the request line matters
+        std::string request;
+        char buffer[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+            if (!readable(client, 1000)) return;
+            int n = static_cast<int>(::recv(client, buffer, sizeof(buffer), 0));
+            if (n <= 0) return;
+            request.append(buffer, n);
+        }
+
+        std::string status = "200 OK";
+        std::string body;
+        if (request.rfind("GET ", 0) != 0) {
+            status = "405 Method Not Allowed";
+        } else {
+            body = render();
+        }
+        std::string response = "HTTP/1.0 " + status + "\r\n"
+                               "Content-Type: text/plain; version=0.0.4\r\n"
+                               "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                               "Connection: close\r\n\r\n" + body;
+        size_t sent = 0;
+        while (sent < response.size()) {
+            int n = static_cast<int>(::send(client, response.data() + sent, static_cast<int>(response.size() - sent), SEND_FLAGS));
+            if (n <= 0) return;
+            sent += n;
+        }
+    }
+
+    std::function<std::string()> render;
+    std::string socket_path;
+    Socket listener;
+    std::atomic<bool> stop_requested{false};
+    std::thread server;
+};
+
+#endif // METRICS_SERVER_HPP
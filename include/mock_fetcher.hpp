@@ -0,0 +1,71 @@
+#ifndef MOCK_FETCHER_HPP
+#define MOCK_FETCHER_HPP
+
+#include <string>
+#include <cstdint>
+
+#include "fetcher.hpp"
+#include "page_names.hpp"
+
+// In-process transport serving a generated site on whatever host it is asked for: "/" and
+// /m/<name> are pages of a tree with `fanout` children per page and `pages` pages in all; anything
+// else is a 404. Each page carries its own filler text, so pages are not near-duplicates of each other.
+// Nothing leaves the process, which makes it the baseline for measuring everything but the network.
+class MockFetcher : public DelayedFetcher {
+public:
+    MockFetcher(uint64_t pages, uint64_t fanout, int latency_ms)
+        : pages(pages), fanout(fanout), latency_micros(uint64_t(latency_ms) * 1000) {}
+
+    const char* name() const override { return "mock"; }
+
+protected:
+    FetchResponse respond(const FetchRequest& request, uint64_t& delay_micros) override {
+        delay_micros = latency_micros;
+        FetchResponse response;
+        size_t path_start = request.url.find('/', request.url.find("//") + 2);
+        std::string path = path_start == std::string::npos ? "/" : request.url.substr(path_start);
+        uint64_t id = 0;
+        if (path != "/" && !(path.rfind("/m/", 0) == 0 && parse_page_name(path.substr(3), id) && id < pages)) {
+            response.status = 404;
+            response.content_type = "text/plain";
+            response.body = "not found\n";
+        } else {
+            response.status = 200;
+            response.content_type = "text/html; charset=utf-8";
+            response.body = page(id);
+        }
+        response.response_headers = "HTTP/1.1 " + std::to_string(response.status) + (response.status == 200 ? " OK" : " Not Found") +
+                                    "\r\nContent-Type: " + response.content_type +
+                                    "\r\nContent-Length: " + std::to_string(response.body.size()) + "\r\n\r\n";
+        return response;
+    }
+
+private:
+    std::string page(uint64_t id) const {
+        std::string html = "<html><head><title>Page " + page_name(id) + "</title></head><body><p>";
+        uint64_t state = id * 0x9E3779B97F4A7C15ULL + 1;
+        for (int word = 0; word < 120; ++word) {
+            state ^= state << 13; // xorshift64
+            state ^= state >> 7;
+            state ^= state << 17;
+            for (uint64_t letters = 2 + state % 7, bits = state >> 8; letters > 0; --letters, bits /= 26) {
+                html.push_back(static_cast<char>('a' + bits % 26));
+            }
+            html.push_back(' ');
+        }
+        html += "</p>\n";
+        for (uint64_t k = 1; k <= fanout; ++k) {
+            uint64_t child = id * fanout + k;
+            if (child < pages) html += "<a href=\"/m/" + page_name(child) + "\">child</a>\n";
+        }
+        if (id > 0) html += "<a href=\"/m/" + page_name((id - 1) / fanout) + "\">up</a>\n";
+        html += "</body></html>\n";
+        return html;
+    }
+
+    const uint64_t pages;
+    const uint64_t fanout;
+    const uint64_t latency_micros;
+};
+
+#endif // MOCK_FETCHER_HPP
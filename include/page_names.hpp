@@ -0,0 +1,29 @@
+#ifndef PAGE_NAMES_HPP
+#define PAGE_NAMES_HPP
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+// Page IDs of the generated sites (mock transport, synthetic_site, crawl simulator) in URLs: the
+// decimal ID, so /p/1234 is page 1234, as a numbered catalogue on a real site would name it.
+inline std::string page_name(uint64_t id) {
+    return std::to_string(id);
+}
+
+// Inverse of page_name. False for anything but the canonical decimal form of a 64-bit ID (no sign,
+// no leading zeros), so every page has exactly one URL.
+inline bool parse_page_name(std::string_view name, uint64_t& id) {
+    if (name.empty() || name.size() > 20 || (name.size() > 1 && name[0] == '0')) return false;
+    uint64_t value = 0;
+    for (char c : name) {
+        if (c < '0' || c > '9') return false;
+        uint64_t digit = static_cast<uint64_t>(c - '0');
+        if (value > (UINT64_MAX - digit) / 10) return false;
+        value = value * 10 + digit;
+    }
+    id = value;
+    return true;
+}
+
+#endif // PAGE_NAMES_HPP
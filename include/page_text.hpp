@@ -0,0 +1,29 @@
+#ifndef PAGE_TEXT_HPP
+#define PAGE_TEXT_HPP
+
+#include <string>
+#include <gumbo.h>
+
+// Appends the visible text of a parsed page to `out`, one space between text nodes.
+// Skips the contents of <script>, <style>, <noscript> and <template>, which the user never sees.
+inline void extract_visible_text(GumboNode* node, std::string& out) {
+    if (node->type == GUMBO_NODE_TEXT) {
+        out.append(node->v.text.text);
+        out.push_back(' ');
+        return;
+    }
+    if (node->type != GUMBO_NODE_ELEMENT) return;
+
+    GumboTag tag = node->v.element.tag;
+    if (tag == GUMBO_TAG_SCRIPT || tag == GUMBO_TAG_STYLE ||
+        tag == GUMBO_TAG_NOSCRIPT || tag == GUMBO_TAG_TEMPLATE) {
+        return;
+    }
+
+    GumboVector* children = &node->v.element.children;
+    for (unsigned int i = 0; i < children->length; ++i) {
+        extract_visible_text(static_cast<GumboNode*>(children->data[i]), out);
+    }
+}
+
+#endif // PAGE_TEXT_HPP
@@ -0,0 +1,249 @@
+#ifndef PAGERANK_HPP
+#define PAGERANK_HPP
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+#include "link_graph.hpp"
+
+struct PageRankOptions {
+    double damping = 0.85;
+    double tolerance = 1e-6;   // Stop once the L1 change of the rank vector drops below this
+    int max_iterations = 100;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+};
+
+struct PageRankResult {
+    std::vector<double> scores; // Sums to 1
+    int iterations = 0;
+    double delta = 0.0;         // L1 change in the last iteration
+};
+
+// Multi-threaded PageRank over a link graph file.
+//
+// The edges are re-partitioned once into tiles: destinations are split into ranges (the unit of
+// parallel work) and, within a range, edges are grouped by blocks of SRC_BLOCK source nodes.
+// Ranges are sized so every thread gets RANGES_PER_THREAD of them, but never more than MAX_RANGE
+// nodes: processing one tile then only reads a 1 MB slice of the contribution vector and only
+// writes an accumulator of at most 512 KB that belongs to the thread, so both stay in cache, and no
+// two threads ever write the same destination (no atomics). Each edge is stored as a 32-bit source
+// and a 16-bit offset into its destination range, 6 bytes per edge.
+//
+// run() starts its threads once and hands them both phases of every iteration; each thread keeps
+// its accumulator for the whole run.
+//
+// Rank held by dangling nodes (no outgoing links) is spread evenly over all nodes every iteration.
+class PageRank {
+public:
+    static constexpr uint32_t MAX_RANGE_BITS = 16; // Destination offsets are 16 bits
+    static constexpr uint32_t MIN_RANGE_BITS = 6;  // 64 nodes: ranges never share a cache line of `next`
+    static constexpr uint32_t SRC_BLOCK_BITS = 17;
+    static constexpr uint64_t RANGES_PER_THREAD = 4; // Slack for dynamic scheduling between threads
+
+    // Partitions the graph for a run on `threads` threads (other thread counts still work, only with
+    // a less even split).
+    explicit PageRank(const LinkGraphView& graph, unsigned threads = std::max(1u, std::thread::hardware_concurrency()))
+        : num_nodes(graph.num_nodes()) {
+        uint64_t per_range = num_nodes / (std::max(1u, threads) * RANGES_PER_THREAD);
+        range_bits = MIN_RANGE_BITS;
+        while (range_bits < MAX_RANGE_BITS && (uint64_t(1) << range_bits) < per_range) {
+            range_bits++;
+        }
+        num_ranges = (num_nodes + range_size() - 1) >> range_bits;
+        num_src_blocks = (num_nodes + (uint64_t(1) << SRC_BLOCK_BITS) - 1) >> SRC_BLOCK_BITS;
+        out_degree.resize(num_nodes);
+
+        // Pass 1: count edges per tile (and out-degrees)
+        tile_offsets.assign(num_ranges * num_src_blocks + 1, 0);
+        for (uint64_t src = 0; src < num_nodes; ++src) {
+            uint32_t degree = 0;
+            graph.for_each_neighbor(src, [&](uint32_t dst) {
+                tile_offsets[tile_of(src, dst) + 1]++;
+                degree++;
+            });
+            out_degree[src] = degree;
+        }
+        for (size_t t = 1; t < tile_offsets.size(); ++t) {
+            tile_offsets[t] += tile_offsets[t - 1];
+        }
+
+        // Pass 2: scatter the edges into their tiles
+        uint64_t num_edges = tile_offsets.back();
+        edge_src.resize(num_edges);
+        edge_dst.resize(num_edges);
+        std::vector<uint64_t> cursor(tile_offsets.begin(), tile_offsets.end() - 1);
+        for (uint64_t src = 0; src < num_nodes; ++src) {
+            graph.for_each_neighbor(src, [&](uint32_t dst) {
+                uint64_t slot = cursor[tile_of(src, dst)]++;
+                edge_src[slot] = static_cast<uint32_t>(src);
+                edge_dst[slot] = static_cast<uint16_t>(dst & (range_size() - 1));
+            });
+        }
+    }
+
+    PageRankResult run(const PageRankOptions& options) const {
+        PageRankResult result;
+        if (num_nodes == 0) return result;
+
+        const double n = static_cast<double>(num_nodes);
+        std::vector<double> rank(num_nodes, 1.0 / n);
+        std::vector<double> next(num_nodes);
+        std::vector<double> contrib(num_nodes);
+        const unsigned threads = static_cast<unsigned>(std::min<uint64_t>(std::max(1u, options.threads), num_ranges));
+        TaskPool pool(threads);
+        std::vector<std::vector<double>> acc(threads, std::vector<double>(range_size())); // One per thread
+        std::vector<double> range_dangling(num_ranges);
+        std::vector<double> range_delta(num_ranges);
+
+        for (result.iterations = 1; result.iterations <= options.max_iterations; ++result.iterations) {
+            // Phase 1: per-node contribution, and the rank sitting on dangling nodes
+            pool.run(num_ranges, [&](uint64_t r, unsigned) {
+                uint64_t end = std::min(num_nodes, (r + 1) << range_bits);
+                double dangling = 0.0;
+                for (uint64_t v = r << range_bits; v < end; ++v) {
+                    if (out_degree[v] == 0) {
+                        dangling += rank[v];
+                        contrib[v] = 0.0;
+                    } else {
+                        contrib[v] = rank[v] / out_degree[v];
+                    }
+                }
+                range_dangling[r] = dangling;
+            });
+            double dangling = 0.0;
+            for (double d : range_dangling) dangling += d;
+            const double base = (1.0 - options.damping) / n + options.damping * dangling / n;
+
+            // Phase 2: pull contributions tile by tile into each destination range
+            pool.run(num_ranges, [&](uint64_t r, unsigned thread) {
+                uint64_t lo = r << range_bits;
+                uint64_t hi = std::min(num_nodes, lo + range_size());
+                std::vector<double>& sums = acc[thread];
+                std::fill(sums.begin(), sums.begin() + (hi - lo), 0.0);
+                for (uint64_t b = 0; b < num_src_blocks; ++b) {
+                    uint64_t tile = r * num_src_blocks + b;
+                    for (uint64_t e = tile_offsets[tile]; e < tile_offsets[tile + 1]; ++e) {
+                        sums[edge_dst[e]] += contrib[edge_src[e]];
+                    }
+                }
+                double delta = 0.0;
+                for (uint64_t u = lo; u < hi; ++u) {
+                    next[u] = base + options.damping * sums[u - lo];
+                    delta += std::fabs(next[u] - rank[u]);
+                }
+                range_delta[r] = delta;
+            });
+
+            rank.swap(next);
+            result.delta = 0.0;
+            for (double d : range_delta) result.delta += d;
+            if (result.delta < options.tolerance) {
+                break;
+            }
+        }
+        result.iterations = std::min(result.iterations, options.max_iterations);
+        result.scores = std::move(rank);
+        return result;
+    }
+
+    uint64_t edge_count() const { return edge_src.size(); }
+
+private:
+    // Threads that stay up for a whole run. run() hands out f(0, thread) .. f(tasks - 1, thread)
+    // dynamically, with the calling thread as thread 0, and returns once all tasks are done.
+    class TaskPool {
+    public:
+        explicit TaskPool(unsigned threads) {
+            for (unsigned i = 1; i < threads; ++i) {
+                helpers.emplace_back(&TaskPool::helper_loop, this, i);
+            }
+        }
+
+        ~TaskPool() {
+            {
+                std::lock_guard<std::mutex> lock(mut);
+                stopping = true;
+            }
+            start_cond.notify_all();
+            for (std::thread& t : helpers) {
+                t.join();
+            }
+        }
+
+        TaskPool(const TaskPool&) = delete;
+        TaskPool& operator=(const TaskPool&) = delete;
+
+        void run(uint64_t tasks, const std::function<void(uint64_t, unsigned)>& f) {
+            {
+                std::lock_guard<std::mutex> lock(mut);
+                job = &f;
+                job_tasks = tasks;
+                next_task = 0;
+                busy = static_cast<unsigned>(helpers.size());
+                generation++;
+            }
+            start_cond.notify_all();
+            work(0);
+            std::unique_lock<std::mutex> lock(mut);
+            done_cond.wait(lock, [this] { return busy == 0; });
+        }
+
+    private:
+        void helper_loop(unsigned thread) {
+            uint64_t seen = 0;
+            std::unique_lock<std::mutex> lock(mut);
+            while (true) {
+                start_cond.wait(lock, [&] { return generation != seen || stopping; });
+                if (stopping) break;
+                seen = generation;
+                lock.unlock();
+                work(thread);
+                lock.lock();
+                if (--busy == 0) {
+                    done_cond.notify_one();
+                }
+            }
+        }
+
+        void work(unsigned thread) {
+            for (uint64_t t = next_task++; t < job_tasks; t = next_task++) {
+                (*job)(t, thread);
+            }
+        }
+
+        std::vector<std::thread> helpers;
+        const std::function<void(uint64_t, unsigned)>* job = nullptr;
+        uint64_t job_tasks = 0;
+        std::atomic<uint64_t> next_task{0};
+        unsigned busy = 0;        // Helpers still working on the current job
+        uint64_t generation = 0;  // Bumped for every job
+        bool stopping = false;
+        std::mutex mut;                     // Mutex to protect job, job_tasks, busy, generation and stopping
+        std::condition_variable start_cond; // Wakes the helpers for a job (or to stop)
+        std::condition_variable done_cond;  // Wakes run() once the helpers are done
+    };
+
+    uint64_t range_size() const { return uint64_t(1) << range_bits; }
+
+    uint64_t tile_of(uint64_t src, uint64_t dst) const {
+        return (dst >> range_bits) * num_src_blocks + (src >> SRC_BLOCK_BITS);
+    }
+
+    uint64_t num_nodes;
+    uint32_t range_bits = MAX_RANGE_BITS; // Destination range of 2^range_bits nodes
+    uint64_t num_ranges = 0;
+    uint64_t num_src_blocks = 0;
+    std::vector<uint32_t> out_degree;
+    std::vector<uint64_t> tile_offsets; // Edge index where each tile starts
+    std::vector<uint32_t> edge_src;
+    std::vector<uint16_t> edge_dst;     // Offset of the destination within its range
+};
+
+#endif // PAGERANK_HPP
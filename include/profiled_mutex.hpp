@@ -0,0 +1,159 @@
+#ifndef PROFILED_MUTEX_HPP
+#define PROFILED_MUTEX_HPP
+
+#include <mutex>
+#include <condition_variable>
+
+// Lock contention profiling, compiled in with -DCRAWLER_LOCK_PROFILING=ON.
+//
+// Containers declare their lock as CrawlerMutex (and wait on a CrawlerCondition) and give it a name
+// with name_lock(). In a normal build those are plain std::mutex / std::condition_variable and
+// name_lock() does nothing, so the instrumentation costs nothing unless it is switched on.
+
+#ifdef CRAWLER_LOCK_PROFILING
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "latency_histogram.hpp"
+
+class ProfiledMutex;
+
+// Every ProfiledMutex alive, for the shutdown report.
+class LockProfiler {
+public:
+    static LockProfiler& instance() {
+        static LockProfiler profiler;
+        return profiler;
+    }
+
+    void add(ProfiledMutex* lock) {
+        std::lock_guard<std::mutex> guard(mut);
+        locks.push_back(lock);
+    }
+
+    void remove(ProfiledMutex* lock) {
+        std::lock_guard<std::mutex> guard(mut);
+        locks.erase(std::remove(locks.begin(), locks.end(), lock), locks.end());
+    }
+
+    // One line per lock name (instances sharing a name are added up). Times are in microseconds.
+    inline void report(std::ostream& os);
+
+private:
+    std::vector<ProfiledMutex*> locks;
+    std::mutex mut; // Mutex to protect locks
+};
+
+// A mutex that counts acquisitions and records how long threads waited for it (when it was taken)
+// and how long it was held. The statistics are only touched while the lock itself is held, so they
+// need no synchronization of their own. Durations are recorded in nanoseconds.
+class ProfiledMutex {
+public:
+    ProfiledMutex() { LockProfiler::instance().add(this); }
+    ~ProfiledMutex() { LockProfiler::instance().remove(this); }
+
+    ProfiledMutex(const ProfiledMutex&) = delete;
+    ProfiledMutex& operator=(const ProfiledMutex&) = delete;
+
+    void set_name(const char* lock_name) { name = lock_name; }
+
+    void lock() {
+        if (inner.try_lock()) {
+            acquired_at = now();
+            acquisitions++;
+            return;
+        }
+        uint64_t wait_start = now();
+        inner.lock();
+        acquired_at = now();
+        acquisitions++;
+        contended++;
+        wait.add(acquired_at - wait_start);
+    }
+
+    bool try_lock() {
+        if (!inner.try_lock()) return false;
+        acquired_at = now();
+        acquisitions++;
+        return true;
+    }
+
+    void unlock() {
+        hold.add(now() - acquired_at);
+        inner.unlock();
+    }
+
+private:
+    friend class LockProfiler;
+
+    static uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    std::mutex inner;
+    const char* name = "unnamed";
+    uint64_t acquired_at = 0;
+    uint64_t acquisitions = 0;
+    uint64_t contended = 0;
+    LatencyHistogram wait; // Contended acquisitions only
+    LatencyHistogram hold;
+};
+
+inline void LockProfiler::report(std::ostream& os) {
+    struct Totals {
+        uint64_t acquisitions = 0;
+        uint64_t contended = 0;
+        LatencyHistogram wait;
+        LatencyHistogram hold;
+    };
+    std::map<std::string, Totals> by_name;
+    {
+        std::lock_guard<std::mutex> guard(mut);
+        for (ProfiledMutex* lock : locks) {
+            std::lock_guard<std::mutex> inner_guard(lock->inner); // Stats only change under this lock
+            Totals& totals = by_name[lock->name];
+            totals.acquisitions += lock->acquisitions;
+            totals.contended += lock->contended;
+            totals.wait.merge(lock->wait);
+            totals.hold.merge(lock->hold);
+        }
+    }
+
+    os << "--- Lock Contention (us) ---" << std::endl;
+    char line[192];
+    std::snprintf(line, sizeof(line), "  %-16s %12s %10s %7s %11s %9s %9s %11s %9s %9s", "lock", "acquired",
+                  "contended", "%", "wait total", "wait p50", "wait p99", "hold total", "hold p50", "hold p99");
+    os << line << std::endl;
+    for (const auto& [name, t] : by_name) {
+        std::snprintf(line, sizeof(line), "  %-16s %12llu %10llu %6.2f%% %11.0f %9.2f %9.2f %11.0f %9.2f %9.2f",
+                      name.c_str(), static_cast<unsigned long long>(t.acquisitions),
+                      static_cast<unsigned long long>(t.contended),
+                      t.acquisitions ? 100.0 * t.contended / t.acquisitions : 0.0,
+                      t.wait.sum / 1000.0, t.wait.percentile(50) / 1000.0, t.wait.percentile(99) / 1000.0,
+                      t.hold.sum / 1000.0, t.hold.percentile(50) / 1000.0, t.hold.percentile(99) / 1000.0);
+        os << line << std::endl;
+    }
+}
+
+using CrawlerMutex = ProfiledMutex;
+using CrawlerCondition = std::condition_variable_any; // std::condition_variable only accepts std::mutex
+
+inline void name_lock(ProfiledMutex& lock, const char* name) { lock.set_name(name); }
+
+#else
+
+using CrawlerMutex = std::mutex;
+using CrawlerCondition = std::condition_variable;
+
+inline void name_lock(std::mutex&, const char*) {}
+
+#endif // CRAWLER_LOCK_PROFILING
+
+#endif // PROFILED_MUTEX_HPP
@@ -0,0 +1,55 @@
+#ifndef REPLAY_FETCHER_HPP
+#define REPLAY_FETCHER_HPP
+
+#include <string>
+#include <cstdint>
+
+#include "fetcher.hpp"
+#include "replay_store.hpp"
+#include "content_hash.hpp"
+#include "link_extractor.hpp"
+
+// How long a replayed response takes to "arrive".
+enum class ReplayLatency { Zero, Recorded, Synthetic };
+
+// Offline transport: answers from a ReplayStore (--replay). A URL the recording does not have
+// fails with CURLE_REMOTE_FILE_NOT_FOUND.
+class ReplayFetcher : public DelayedFetcher {
+public:
+    // `mean_ms` is only used by Synthetic latency.
+    ReplayFetcher(const ReplayStore& store, ReplayLatency latency, int mean_ms)
+        : store(store), latency(latency), mean_ms(mean_ms) {}
+
+    const char* name() const override { return "replay"; }
+
+protected:
+    FetchResponse respond(const FetchRequest& request, uint64_t& delay_micros) override {
+        FetchResponse response;
+        const ReplayResponse* recorded = store.find(request.url);
+        if (!recorded) {
+            response.error = CURLE_REMOTE_FILE_NOT_FOUND;
+            return response;
+        }
+        // Synthetic latency is derived from the URL, so every run waits the same time for the same page
+        if (latency == ReplayLatency::Recorded) {
+            delay_micros = uint64_t(recorded->fetch_ms) * 1000;
+        } else if (latency == ReplayLatency::Synthetic) {
+            delay_micros = (mean_ms / 2 + content_hash(request.url) % (uint64_t(mean_ms) + 1)) * 1000; // mean +- 50%
+        }
+        response.status = recorded->status;
+        response.content_type = recorded->content_type;
+        response.response_headers = recorded->headers;
+        response.body = recorded->body;
+        if (response.status >= 300 && response.status < 400 && !recorded->location.empty()) {
+            response.location = resolve_url(request.url, recorded->location);
+        }
+        return response;
+    }
+
+private:
+    const ReplayStore& store;
+    const ReplayLatency latency;
+    const int mean_ms;
+};
+
+#endif // REPLAY_FETCHER_HPP
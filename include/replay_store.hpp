@@ -0,0 +1,314 @@
+#ifndef REPLAY_STORE_HPP
+#define REPLAY_STORE_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <optional>
+#include <zlib.h>
+
+#include "mapped_file.hpp"
+
+// One recorded HTTP response.
+struct ReplayResponse {
+    long status = 0;
+    std::string headers;      // Raw response header block, including the final blank line
+    std::string content_type;
+    std::string location;     // Location header of a redirect, as recorded (may be relative)
+    std::string body;
+    uint32_t fetch_ms = 0;    // Recorded transfer time (WARC metadata "fetchTimeMs"); 0 if unknown
+};
+
+// Responses of an earlier crawl, loaded into memory so a replayed crawl can run the whole worker
+// pipeline (parse, extract, dedup, enqueue) without the network and at memory speed.
+//
+// Two sources are understood:
+//   * WARC files, as written with --warc (one gzip member per record) or uncompressed. Response
+//     records provide the responses; metadata records provide fetchTimeMs.
+//   * A mirror directory laid out as <dir>/<host>/<path>, as wget -x / --mirror writes it. Every
+//     file is served as a 200 with a content type guessed from its name, and <path>/index.html
+//     also answers for <path>/ and <path>.
+// Everything is loaded up front; afterwards the store is read-only and safe to share between workers.
+class ReplayStore {
+public:
+    // `path` is a mirror directory, a WARC file, or a --warc prefix (all <prefix>-NNNNN.warc.gz files).
+    explicit ReplayStore(const std::string& path) {
+        namespace fs = std::filesystem;
+        if (fs::is_directory(path)) {
+            load_mirror(path);
+        } else if (fs::is_regular_file(path)) {
+            load_warc(path);
+        } else {
+            for (int i = 0; ; ++i) {
+                char suffix[32];
+                std::snprintf(suffix, sizeof(suffix), "-%05d.warc.gz", i);
+                if (!fs::is_regular_file(path + suffix)) {
+                    if (i == 0) throw std::runtime_error("No WARC files or directory at " + path);
+                    break;
+                }
+                load_warc(path + suffix);
+            }
+        }
+    }
+
+    ReplayStore(const ReplayStore&) = delete;
+    ReplayStore& operator=(const ReplayStore&) = delete;
+
+    // The recorded response for `url`, or nullptr if the recording does not have it.
+    const ReplayResponse* find(const std::string& url) const {
+        auto it = by_key.find(key_of(url));
+        return it == by_key.end() ? nullptr : &responses[it->second];
+    }
+
+    size_t size() const { return responses.size(); }
+
+    uint64_t body_bytes() const {
+        uint64_t total = 0;
+        for (const ReplayResponse& response : responses) total += response.body.size();
+        return total;
+    }
+
+    // Lookup key: the URL without scheme and fragment, host lower-cased.
+    // "https://Example.com/a?b#c" and "http://example.com/a?b" both become "example.com/a?b".
+    static std::string key_of(const std::string& url) {
+        size_t start = url.find("://");
+        start = start == std::string::npos ? 0 : start + 3;
+        size_t end = url.find('#', start);
+        std::string key = url.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        size_t host_end = std::min(key.find_first_of("/?"), key.size());
+        for (size_t i = 0; i < host_end; ++i) {
+            key[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(key[i])));
+        }
+        return key;
+    }
+
+private:
+    void add(const std::string& key, ReplayResponse response) {
+        if (by_key.count(key)) return; // A URL recorded twice keeps its first response, as the crawl would
+        by_key.emplace(key, responses.size());
+        responses.push_back(std::move(response));
+    }
+
+    // Makes `alias` answer with the response stored under `key`.
+    void alias(const std::string& alias, const std::string& key) {
+        auto it = by_key.find(key);
+        if (it != by_key.end()) by_key.emplace(alias, it->second);
+    }
+
+    // --- Mirror directories ---
+
+    void load_mirror(const std::filesystem::path& root) {
+        namespace fs = std::filesystem;
+        for (const auto& entry : fs::recursive_directory_iterator(root)) {
+            if (!entry.is_regular_file()) continue;
+            std::string relative = fs::relative(entry.path(), root).generic_string();
+            std::ifstream in(entry.path(), std::ios::binary);
+            std::stringstream text;
+            text << in.rdbuf();
+
+            ReplayResponse response;
+            response.status = 200;
+            response.body = text.str();
+            response.content_type = guess_content_type(relative, response.body);
+            response.headers = "HTTP/1.1 200 OK\r\nContent-Type: " + response.content_type +
+                               "\r\nContent-Length: " + std::to_string(response.body.size()) + "\r\n\r\n";
+
+            std::string key = key_of(relative);
+            add(key, std::move(response));
+            const std::string index = "/index.html";
+            if (key.size() > index.size() && key.compare(key.size() - index.size(), index.size(), index) == 0) {
+                std::string directory = key.substr(0, key.size() - index.size());
+                alias(directory + "/", key);
+                alias(directory, key);
+            }
+        }
+    }
+
+    static std::string guess_content_type(const std::string& name, const std::string& body) {
+        static const std::pair<const char*, const char*> types[] = {
+            {".html", "text/html"}, {".htm", "text/html"}, {".xhtml", "text/html"}, {".css", "text/css"},
+            {".js", "application/javascript"}, {".json", "application/json"}, {".xml", "application/xml"},
+            {".txt", "text/plain"}, {".png", "image/png"}, {".jpg", "image/jpeg"}, {".jpeg", "image/jpeg"},
+            {".gif", "image/gif"}, {".svg", "image/svg+xml"}, {".pdf", "application/pdf"}};
+        std::string path = name.substr(0, name.find('?'));
+        for (const auto& [extension, type] : types) {
+            size_t length = std::strlen(extension);
+            if (path.size() >= length && path.compare(path.size() - length, length, extension) == 0) return type;
+        }
+        // No known extension (pages saved under their URL path): sniff for markup
+        size_t first = body.find_first_not_of(" \t\r\n");
+        return first != std::string::npos && body[first] == '<' ? "text/html" : "application/octet-stream";
+    }
+
+    // --- WARC files ---
+
+    void load_warc(const std::string& path) {
+        MappedFile file(path);
+        const char* data = reinterpret_cast<const char*>(file.data());
+        if (file.size() >= 2 && file.data()[0] == 0x1f && file.data()[1] == 0x8b) {
+            std::string inflated = gunzip_members(file.data(), file.size(), path);
+            parse_records(inflated.data(), inflated.size(), path);
+        } else {
+            parse_records(data, file.size(), path);
+        }
+    }
+
+    // Inflates a file of concatenated gzip members (the WARC convention) into one buffer.
+    static std::string gunzip_members(const unsigned char* data, size_t size, const std::string& path) {
+        z_stream stream{};
+        if (inflateInit2(&stream, 15 + 16) != Z_OK) {
+            throw std::runtime_error("inflateInit2 failed");
+        }
+        std::string out;
+        std::vector<unsigned char> chunk(size_t(1) << 18);
+        stream.next_in = const_cast<Bytef*>(data);
+        stream.avail_in = static_cast<uInt>(size);
+        while (true) {
+            stream.next_out = chunk.data();
+            stream.avail_out = static_cast<uInt>(chunk.size());
+            int status = inflate(&stream, Z_NO_FLUSH);
+            out.append(reinterpret_cast<const char*>(chunk.data()), chunk.size() - stream.avail_out);
+            if (status == Z_STREAM_END) {
+                if (stream.avail_in == 0) break;
+                inflateReset(&stream); // Next member
+            } else if (status == Z_BUF_ERROR && stream.avail_in == 0) {
+                break; // Truncated last member: keep what was inflated
+            } else if (status != Z_OK) {
+                inflateEnd(&stream);
+                throw std::runtime_error("Corrupt gzip data in " + path);
+            }
+        }
+        inflateEnd(&stream);
+        return out;
+    }
+
+    void parse_records(const char* data, size_t size, const std::string& path) {
+        std::unordered_map<std::string, size_t> response_ids; // WARC-Record-ID -> index, for metadata records
+        size_t pos = 0;
+        while (pos < size) {
+            if (size - pos < 5 || std::string(data + pos, 5) != "WARC/") {
+                throw std::runtime_error("Malformed WARC record in " + path);
+            }
+            size_t head_end = std::string_view(data + pos, size - pos).find("\r\n\r\n");
+            if (head_end == std::string::npos) break;
+            std::string head(data + pos, head_end);
+            size_t block_start = pos + head_end + 4;
+            size_t length = std::strtoull(header_value(head, "Content-Length").c_str(), nullptr, 10);
+            if (block_start + length > size) break; // Truncated last record
+            std::string_view block(data + block_start, length);
+            pos = block_start + length;
+            while (pos < size && (data[pos] == '\r' || data[pos] == '\n')) pos++;
+
+            std::string type = header_value(head, "WARC-Type");
+            if (type == "response" && header_value(head, "Content-Type").rfind("application/http", 0) == 0) {
+                std::string key = key_of(header_value(head, "WARC-Target-URI"));
+                bool fresh = !by_key.count(key);
+                add(key, parse_http_response(block));
+                if (fresh) response_ids[header_value(head, "WARC-Record-ID")] = by_key[key];
+            } else if (type == "metadata") {
+                auto it = response_ids.find(header_value(head, "WARC-Concurrent-To"));
+                std::string fetch_ms = header_value(std::string(block), "fetchTimeMs");
+                if (it != response_ids.end() && !fetch_ms.empty()) {
+                    responses[it->second].fetch_ms = static_cast<uint32_t>(std::strtoul(fetch_ms.c_str(), nullptr, 10));
+                }
+            }
+        }
+    }
+
+    static ReplayResponse parse_http_response(std::string_view block) {
+        ReplayResponse response;
+        size_t head_end = block.find("\r\n\r\n");
+        if (head_end == std::string_view::npos) {
+            response.headers = std::string(block);
+            return response;
+        }
+        response.headers = std::string(block.substr(0, head_end + 4));
+        response.body = std::string(block.substr(head_end + 4));
+        size_t space = response.headers.find(' ');
+        if (space != std::string::npos) response.status = std::strtol(response.headers.c_str() + space + 1, nullptr, 10);
+        response.content_type = header_value(response.headers, "Content-Type");
+        response.location = header_value(response.headers, "Location");
+        if (header_value(response.headers, "Transfer-Encoding").find("chunked") != std::string::npos) {
+            // Archives from other tools may keep the framing, but many (this crawler's before it
+            // renamed the header) store the decoded body under the original header: only a body
+            // that really is chunked is decoded
+            if (std::optional<std::string> body = dechunk(response.body)) response.body = std::move(*body);
+        }
+        return response;
+    }
+
+    // The payload of a chunked body, or nullopt unless `chunked` is a sequence of well-formed chunks
+    // ending with the 0-size chunk (then optional trailers, and nothing but line breaks).
+    static std::optional<std::string> dechunk(const std::string& chunked) {
+        std::string out;
+        size_t pos = 0;
+        while (true) {
+            size_t line_end = chunked.find("\r\n", pos);
+            if (line_end == std::string::npos) return std::nullopt;
+            size_t size_end = pos;
+            while (size_end < line_end && std::isxdigit(static_cast<unsigned char>(chunked[size_end]))) size_end++;
+            if (size_end == pos || size_end - pos > 15) return std::nullopt;
+            if (size_end < line_end && chunked[size_end] != ';' && chunked[size_end] != ' ' && chunked[size_end] != '\t') {
+                return std::nullopt; // Only chunk extensions may follow the size
+            }
+            size_t length = std::strtoull(chunked.c_str() + pos, nullptr, 16);
+            pos = line_end + 2;
+            if (length == 0) break;
+            if (length > chunked.size() - pos || chunked.size() - pos - length < 2 ||
+                chunked.compare(pos + length, 2, "\r\n") != 0) {
+                return std::nullopt;
+            }
+            out.append(chunked, pos, length);
+            pos += length + 2;
+        }
+        // Trailer fields, then the blank line that ends the message
+        while (true) {
+            size_t line_end = chunked.find("\r\n", pos);
+            if (line_end == std::string::npos) return std::nullopt;
+            if (line_end == pos) {
+                if (chunked.find_first_not_of("\r\n", pos) != std::string::npos) return std::nullopt;
+                return out;
+            }
+            pos = line_end + 2;
+        }
+    }
+
+    // Value of the first "Name: value" line in a header block (name matched case-insensitively).
+    static std::string header_value(const std::string& head, const char* name) {
+        size_t name_length = std::strlen(name);
+        size_t pos = 0;
+        while (pos < head.size()) {
+            size_t line_end = head.find("\r\n", pos);
+            if (line_end == std::string::npos) line_end = head.size();
+            if (line_end - pos > name_length && head[pos + name_length] == ':') {
+                bool match = true;
+                for (size_t i = 0; i < name_length && match; ++i) {
+                    match = std::tolower(static_cast<unsigned char>(head[pos + i])) ==
+                            std::tolower(static_cast<unsigned char>(name[i]));
+                }
+                if (match) {
+                    size_t value_start = head.find_first_not_of(' ', pos + name_length + 1);
+                    return value_start >= line_end ? "" : head.substr(value_start, line_end - value_start);
+                }
+            }
+            pos = line_end + 2;
+        }
+        return "";
+    }
+
+    std::vector<ReplayResponse> responses;
+    std::unordered_map<std::string, size_t> by_key; // key_of(url) -> index into responses
+};
+
+#endif // REPLAY_STORE_HPP
@@ -0,0 +1,156 @@
+#ifndef SIMHASH_HPP
+#define SIMHASH_HPP
+
+#include <cstdint>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <mutex>
+#include <optional>
+
+#include "content_hash.hpp"
+
+// 64-bit SimHash over word shingles of a page's visible text.
+// Pages that differ only in a timestamp or an ad slot change a handful of shingles, so their
+// fingerprints end up within a small Hamming distance of each other.
+namespace simhash_detail {
+
+constexpr int SHINGLE_WORDS = 3; // Words per shingle
+
+// Hashes every lower-cased alphanumeric word of `text`.
+inline void hash_words(const std::string& text, std::vector<uint64_t>& word_hashes) {
+    std::string word;
+    for (size_t i = 0; i <= text.size(); ++i) {
+        unsigned char c = i < text.size() ? static_cast<unsigned char>(text[i]) : ' ';
+        if (std::isalnum(c)) {
+            word.push_back(static_cast<char>(std::tolower(c)));
+        } else if (!word.empty()) {
+            word_hashes.push_back(content_hash(word));
+            word.clear();
+        }
+    }
+}
+
+// Combines SHINGLE_WORDS consecutive word hashes into one shingle hash per position.
+inline void hash_shingles(const std::vector<uint64_t>& word_hashes, std::vector<uint64_t>& shingles) {
+    if (word_hashes.size() < SHINGLE_WORDS) {
+        shingles.assign(word_hashes.begin(), word_hashes.end()); // Short page: words are the features
+        return;
+    }
+    shingles.resize(word_hashes.size() - SHINGLE_WORDS + 1);
+    for (size_t i = 0; i < shingles.size(); ++i) {
+        uint64_t h = word_hashes[i];
+        for (int k = 1; k < SHINGLE_WORDS; ++k) {
+            h = content_hash_detail::merge_round(h, word_hashes[i + k]);
+        }
+        shingles[i] = h;
+    }
+}
+
+// The SimHash kernel: counts, for each of the 64 bit positions, how many shingle hashes have it set.
+// The inner loop has a fixed trip count and no branches, so the compiler turns it into SIMD shifts,
+// masks and adds across the whole counter array. 32-bit counters are plenty for any single page.
+inline void accumulate_bits(const uint64_t* hashes, size_t count, std::array<uint32_t, 64>& ones) {
+    for (size_t i = 0; i < count; ++i) {
+        const uint64_t h = hashes[i];
+        for (int b = 0; b < 64; ++b) {
+            ones[b] += static_cast<uint32_t>((h >> b) & 1u);
+        }
+    }
+}
+
+// Bit b of the fingerprint is set if more than half of the shingles have bit b set.
+inline uint64_t fingerprint_from_counts(const std::array<uint32_t, 64>& ones, size_t count) {
+    uint64_t fp = 0;
+    for (int b = 0; b < 64; ++b) {
+        fp |= static_cast<uint64_t>(2 * static_cast<uint64_t>(ones[b]) > count) << b;
+    }
+    return fp;
+}
+
+} // namespace simhash_detail
+
+// Computes the SimHash of a list of shingle hashes.
+inline uint64_t simhash_of_shingles(const std::vector<uint64_t>& shingles) {
+    std::array<uint32_t, 64> ones{};
+    simhash_detail::accumulate_bits(shingles.data(), shingles.size(), ones);
+    return simhash_detail::fingerprint_from_counts(ones, shingles.size());
+}
+
+// Computes the SimHash of a page's visible text.
+inline uint64_t simhash(const std::string& text) {
+    std::vector<uint64_t> words;
+    std::vector<uint64_t> shingles;
+    simhash_detail::hash_words(text, words);
+    simhash_detail::hash_shingles(words, shingles);
+    return simhash_of_shingles(shingles);
+}
+
+// Pages with fewer shingles than this have too little text for their fingerprint to mean anything:
+// every empty page hashes to 0, and link-only pages land within a few bits of each other. They are
+// neither checked against nor added to the near-duplicate index.
+constexpr size_t MIN_SHINGLES = 16;
+
+// The SimHash of a page's visible text, or nullopt if it has fewer than MIN_SHINGLES shingles.
+inline std::optional<uint64_t> page_simhash(const std::string& text) {
+    std::vector<uint64_t> words;
+    std::vector<uint64_t> shingles;
+    simhash_detail::hash_words(text, words);
+    simhash_detail::hash_shingles(words, shingles);
+    if (shingles.size() < MIN_SHINGLES) return std::nullopt;
+    return simhash_of_shingles(shingles);
+}
+
+inline int hamming_distance(uint64_t a, uint64_t b) {
+    uint64_t x = a ^ b;
+    int n = 0;
+    while (x) {
+        x &= x - 1;
+        n++;
+    }
+    return n;
+}
+
+// An index of SimHash fingerprints answering "is there a fingerprint within MAX_DISTANCE bits?".
+// The 64 bits are split into MAX_DISTANCE + 1 bands. Two fingerprints that differ in at most
+// MAX_DISTANCE bits must agree exactly on at least one band (pigeonhole), so each band has a table
+// keyed by that band's bits, and only the fingerprints in matching buckets are compared in full.
+class SimHashIndex {
+public:
+    static constexpr int MAX_DISTANCE = 3;
+    static constexpr int BANDS = MAX_DISTANCE + 1;
+    static constexpr int BAND_BITS = 64 / BANDS;
+
+    // Returns true if a fingerprint within MAX_DISTANCE of `fp` is already indexed.
+    // Otherwise indexes `fp` and returns false.
+    bool find_or_insert(uint64_t fp) {
+        std::lock_guard<std::mutex> lock(mut);
+        for (int band = 0; band < BANDS; ++band) {
+            auto it = tables[band].find(band_key(fp, band));
+            if (it == tables[band].end()) {
+                continue;
+            }
+            for (uint64_t candidate : it->second) {
+                if (hamming_distance(candidate, fp) <= MAX_DISTANCE) {
+                    return true;
+                }
+            }
+        }
+        for (int band = 0; band < BANDS; ++band) {
+            tables[band][band_key(fp, band)].push_back(fp);
+        }
+        return false;
+    }
+
+private:
+    static uint64_t band_key(uint64_t fp, int band) {
+        return (fp >> (band * BAND_BITS)) & ((uint64_t(1) << BAND_BITS) - 1);
+    }
+
+    std::array<std::unordered_map<uint64_t, std::vector<uint64_t>>, BANDS> tables;
+    std::mutex mut; // Mutex to protect the band tables
+};
+
+#endif // SIMHASH_HPP
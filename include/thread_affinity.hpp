@@ -0,0 +1,331 @@
+#ifndef THREAD_AFFINITY_HPP
+#define THREAD_AFFINITY_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#ifdef CRAWLER_HAVE_NUMA
+#include <numa.h>
+#endif
+
+// One logical CPU and where it sits in the machine.
+struct LogicalCpu {
+    int cpu = 0;
+    int core = 0;    // Physical core ID, unique within the package
+    int package = 0; // Socket
+    int node = 0;    // NUMA node
+};
+
+// The logical CPUs this process may run on. Linux reads the topology from sysfs; elsewhere every
+// CPU counts as its own core on package and node 0.
+inline std::vector<LogicalCpu> detect_cpus() {
+    std::vector<LogicalCpu> cpus;
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return cpus;
+    auto read_int = [](const std::filesystem::path& path, int fallback) {
+        std::ifstream in(path);
+        int value;
+        return in >> value ? value : fallback;
+    };
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed)) continue;
+        std::filesystem::path dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+        LogicalCpu info;
+        info.cpu = cpu;
+        info.core = read_int(dir / "topology" / "core_id", cpu);
+        info.package = read_int(dir / "topology" / "physical_package_id", 0);
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+            std::string name = entry.path().filename().string();
+            if (name.rfind("node", 0) == 0 && name.size() > 4) {
+                info.node = std::atoi(name.c_str() + 4);
+                break;
+            }
+        }
+        cpus.push_back(info);
+    }
+#else
+    for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) {
+        LogicalCpu info;
+        info.cpu = info.core = static_cast<int>(cpu);
+        cpus.push_back(info);
+    }
+#endif
+    return cpus;
+}
+
+// Pins the calling thread to one logical CPU. Returns false where that is not supported.
+inline bool pin_current_thread(int cpu) {
+#ifdef _WIN32
+    if (cpu < 0 || cpu >= 64) return false;
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+// The logical CPU the calling thread is running on right now, or -1 if unknown.
+inline int current_cpu() {
+#ifdef _WIN32
+    return static_cast<int>(GetCurrentProcessorNumber());
+#elif defined(__linux__)
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+// Makes the calling thread's future allocations come from its own NUMA node, whatever policy the
+// process was started with (numactl --interleave, ...). Without libnuma the kernel's default
+// first-touch policy does the same for a pinned thread, unless the process was started otherwise.
+// Returns true if the policy was set.
+inline bool prefer_local_memory() {
+#ifdef CRAWLER_HAVE_NUMA
+    if (numa_available() < 0) return false;
+    numa_set_localalloc();
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Which logical CPU each worker is pinned to (--affinity).
+//
+//   compact   Fill one NUMA node before the next, and a core's hyperthreads before the next core:
+//             workers share caches, and a small pool stays on one socket.
+//   scatter   Round-robin over the nodes, one worker per physical core before any core gets a
+//             second: the most cache and memory bandwidth per worker.
+//   <list>    Exactly these CPUs, in this order ("0-7,16-23").
+//
+// Worker N gets the N-th CPU of that order; with more workers than CPUs the order wraps around.
+// Worker IDs come from WorkerSlots, so a pool that shrinks and grows again keeps to the front of it.
+class CpuAffinity {
+public:
+    enum class Policy { None, Compact, Scatter, List };
+
+    CpuAffinity() = default;
+
+    // Parses an --affinity value against the CPUs this process may use. Returns nullopt for an
+    // unknown policy, a malformed list or a CPU outside the allowed set.
+    static std::optional<CpuAffinity> parse(const std::string& spec, const std::vector<LogicalCpu>& cpus) {
+        if (cpus.empty()) return std::nullopt;
+        CpuAffinity affinity;
+        if (spec == "compact") {
+            affinity.policy = Policy::Compact;
+            affinity.order = compact_order(cpus);
+        } else if (spec == "scatter") {
+            affinity.policy = Policy::Scatter;
+            affinity.order = scatter_order(cpus);
+        } else {
+            affinity.policy = Policy::List;
+            std::map<int, LogicalCpu> by_id;
+            for (const LogicalCpu& cpu : cpus) by_id[cpu.cpu] = cpu;
+            std::optional<std::vector<int>> list = parse_cpu_list(spec);
+            if (!list) return std::nullopt;
+            for (int id : *list) {
+                auto it = by_id.find(id);
+                if (it == by_id.end()) return std::nullopt;
+                affinity.order.push_back(it->second);
+            }
+        }
+        return affinity;
+    }
+
+    bool enabled() const { return policy != Policy::None; }
+
+    const char* policy_name() const {
+        static const char* const names[] = {"none", "compact", "scatter", "list"};
+        return names[static_cast<int>(policy)];
+    }
+
+    const LogicalCpu& cpu_for(int worker) const { return order[static_cast<size_t>(worker) % order.size()]; }
+
+    // "0-3,8" -> {0, 1, 2, 3, 8}
+    static std::optional<std::vector<int>> parse_cpu_list(const std::string& spec) {
+        std::vector<int> ids;
+        size_t pos = 0;
+        while (pos <= spec.size()) {
+            size_t comma = spec.find(',', pos);
+            std::string item = spec.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+            size_t dash = item.find('-');
+            std::string first = item.substr(0, dash);
+            std::string last = dash == std::string::npos ? first : item.substr(dash + 1);
+            if (first.empty() || last.empty() || first.find_first_not_of("0123456789") != std::string::npos ||
+                last.find_first_not_of("0123456789") != std::string::npos) {
+                return std::nullopt;
+            }
+            int low = std::atoi(first.c_str());
+            int high = std::atoi(last.c_str());
+            if (high < low || high >= 4096) return std::nullopt;
+            for (int id = low; id <= high; ++id) ids.push_back(id);
+            if (comma == std::string::npos) break;
+            pos = comma + 1;
+        }
+        return ids;
+    }
+
+private:
+    static std::vector<LogicalCpu> compact_order(std::vector<LogicalCpu> cpus) {
+        std::sort(cpus.begin(), cpus.end(), [](const LogicalCpu& a, const LogicalCpu& b) {
+            return std::make_tuple(a.node, a.package, a.core, a.cpu) < std::make_tuple(b.node, b.package, b.core, b.cpu);
+        });
+        return cpus;
+    }
+
+    static std::vector<LogicalCpu> scatter_order(const std::vector<LogicalCpu>& cpus) {
+        // Rank every CPU by (hyperthread within its core, core within its node), then take the
+        // nodes in turn at each rank
+        std::vector<LogicalCpu> sorted = compact_order(cpus);
+        std::map<std::pair<int, int>, int> sibling_count;     // (package, core) -> hyperthreads seen
+        std::map<int, std::set<std::pair<int, int>>> node_cores; // node -> its (package, core)s so far
+        std::vector<std::tuple<int, int, int, LogicalCpu>> ranked;
+        for (const LogicalCpu& cpu : sorted) {
+            int sibling = sibling_count[{cpu.package, cpu.core}]++;
+            std::set<std::pair<int, int>>& cores = node_cores[cpu.node];
+            cores.insert({cpu.package, cpu.core});
+            int core_rank = static_cast<int>(std::distance(cores.begin(), cores.find({cpu.package, cpu.core})));
+            ranked.emplace_back(sibling, core_rank, cpu.node, cpu);
+        }
+        std::stable_sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) {
+            return std::make_tuple(std::get<0>(a), std::get<1>(a), std::get<2>(a)) <
+                   std::make_tuple(std::get<0>(b), std::get<1>(b), std::get<2>(b));
+        });
+        std::vector<LogicalCpu> order;
+        for (const auto& entry : ranked) order.push_back(std::get<3>(entry));
+        return order;
+    }
+
+    Policy policy = Policy::None;
+    std::vector<LogicalCpu> order;
+};
+
+// Where each worker ran: the CPU it was pinned to, that CPU's NUMA node, whether its memory policy
+// was made node-local, and the CPU it was on at the end of each page. A page ending on another CPU
+// than the previous one counts as a migration.
+struct WorkerPlacement {
+    int worker = 0;
+    int pinned_cpu = -1; // -1: not pinned
+    int node = -1;       // -1: unknown (not pinned)
+    bool local_memory = false;
+    std::atomic<int> last_cpu{-1};
+    std::atomic<uint64_t> pages{0};
+    std::atomic<uint64_t> migrations{0};
+
+    // Called by the worker after every page.
+    void page_done() {
+        int cpu = current_cpu();
+        int previous = last_cpu.exchange(cpu, std::memory_order_relaxed);
+        if (previous != -1 && cpu != previous) migrations.fetch_add(1, std::memory_order_relaxed);
+        pages.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+// Worker IDs for a pool that grows and shrinks (--threads auto). A new worker takes the lowest ID
+// no running worker holds, and an exiting worker gives its ID back, so the IDs (and with them the
+// CPUs and placement entries they map to) stay within the largest pool size the crawl reached.
+class WorkerSlots {
+public:
+    int acquire() {
+        std::lock_guard<std::mutex> lock(mut);
+        if (released.empty()) return next++;
+        int slot = *released.begin();
+        released.erase(released.begin());
+        return slot;
+    }
+
+    void release(int slot) {
+        std::lock_guard<std::mutex> lock(mut);
+        released.insert(slot);
+    }
+
+private:
+    std::mutex mut; // Mutex to protect next and released (the monitor acquires, exiting workers release)
+    int next = 0;
+    std::set<int> released;
+};
+
+// Every worker's placement, for the final report and --stats-json: one entry per worker ID, taken
+// over by the next worker with that ID. Entries are never removed, so a worker can keep its
+// reference for as long as it runs.
+class PlacementTable {
+public:
+    WorkerPlacement& add(int worker) {
+        std::lock_guard<std::mutex> lock(mut);
+        for (WorkerPlacement& placement : placements) {
+            if (placement.worker == worker) {
+                // Its earlier pages and migrations stay; a move from the old thread's CPU is no migration
+                placement.last_cpu.store(-1, std::memory_order_relaxed);
+                return placement;
+            }
+        }
+        placements.emplace_back();
+        placements.back().worker = worker;
+        return placements.back();
+    }
+
+    template <typename Fn>
+    void for_each(Fn fn) const {
+        std::lock_guard<std::mutex> lock(mut);
+        for (const WorkerPlacement& placement : placements) fn(placement);
+    }
+
+    void report(std::ostream& out, const CpuAffinity& affinity) const {
+        std::lock_guard<std::mutex> lock(mut);
+        uint64_t migrations = 0;
+        for (const WorkerPlacement& placement : placements) migrations += placement.migrations.load();
+        out << "--- Worker Placement (affinity " << affinity.policy_name() << ") ---" << std::endl;
+        if (!affinity.enabled()) {
+            out << "  " << placements.size() << " unpinned workers changed CPU " << migrations
+                << " times between pages" << std::endl;
+            return;
+        }
+        out << "  worker   cpu  node  memory      last cpu     pages  migrations" << std::endl;
+        for (const WorkerPlacement& placement : placements) {
+            out << "  " << pad(std::to_string(placement.worker), 6) << pad(std::to_string(placement.pinned_cpu), 6)
+                << pad(std::to_string(placement.node), 6) << "  " << (placement.local_memory ? "local      " : "first-touch")
+                << pad(std::to_string(placement.last_cpu.load()), 9) << pad(std::to_string(placement.pages.load()), 10)
+                << pad(std::to_string(placement.migrations.load()), 12) << std::endl;
+        }
+    }
+
+private:
+    static std::string pad(const std::string& text, size_t width) {
+        return text.size() >= width ? text : std::string(width - text.size(), ' ') + text;
+    }
+
+    // Mutex to protect placements (workers add themselves as the pool grows)
+    mutable std::mutex mut;
+    std::deque<WorkerPlacement> placements;
+};
+
+#endif // THREAD_AFFINITY_HPP
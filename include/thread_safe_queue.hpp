@@ -5,15 +5,33 @@
 #include <mutex>
 #include <condition_variable>
 #include <optional> // Requires C++17
+#include <atomic>
+#include <cstddef>
+
+#include "profiled_mutex.hpp"
+#include "memory_budget.hpp"
 
 // A thread-safe queue for storing URLs to be crawled.
 template <typename T>
 class ThreadSafeQueue {
 public:
+    // `name` identifies the queue's lock in the contention report of a CRAWLER_LOCK_PROFILING build.
+    explicit ThreadSafeQueue(const char* name = "ThreadSafeQueue") {
+        name_lock(mut, name);
+    }
+
+    // Reports the queued items' estimated size into `account` from now on (see MemoryBudget).
+    void track_memory(MemoryAccount* account) {
+        std::lock_guard<CrawlerMutex> lock(mut);
+        memory = account;
+    }
+
     // Adds an item to the back of the queue.
     void push(T item) {
-        std::lock_guard<std::mutex> lock(mut); // Lock the mutex
-        queue.push(item);
+        std::lock_guard<CrawlerMutex> lock(mut); // Lock the mutex
+        if (memory) memory->add(memory_footprint(item));
+        queue.push(std::move(item));
+        count.store(queue.size(), std::memory_order_relaxed);
         cond.notify_one(); // Notify one waiting thread (if any)
     } // Mutex is automatically unlocked when lock goes out of scope
 
@@ -21,7 +39,7 @@ public:
     // Waits if the queue is empty.
     // Returns std::nullopt if the queue is signaled to stop.
     std::optional<T> pop() {
-        std::unique_lock<std::mutex> lock(mut); // Use unique_lock for condition variable
+        std::unique_lock<CrawlerMutex> lock(mut); // Use unique_lock for condition variable
         // Wait until the queue is not empty OR stop_requested is true
         cond.wait(lock, [this] { return !queue.empty() || stop_requested; });
 
@@ -33,27 +51,50 @@ public:
         // Retrieve the item
         T item = queue.front();
         queue.pop();
+        if (memory) memory->sub(memory_footprint(item));
+        count.store(queue.size(), std::memory_order_relaxed);
+        return item;
+    }
+
+    // Removes and returns the front item without waiting.
+    // Returns std::nullopt if the queue is currently empty.
+    std::optional<T> try_pop() {
+        std::lock_guard<CrawlerMutex> lock(mut);
+        if (queue.empty()) {
+            return std::nullopt;
+        }
+        T item = queue.front();
+        queue.pop();
+        if (memory) memory->sub(memory_footprint(item));
+        count.store(queue.size(), std::memory_order_relaxed);
         return item;
     }
 
     // Signals the queue to stop processing and wakes up waiting threads.
     void request_stop() {
-        std::lock_guard<std::mutex> lock(mut);
+        std::lock_guard<CrawlerMutex> lock(mut);
         stop_requested = true;
         cond.notify_all(); // Wake up all waiting threads
     }
 
     // Checks if the queue is empty (thread-safe).
     bool empty() const {
-        std::lock_guard<std::mutex> lock(mut);
+        std::lock_guard<CrawlerMutex> lock(mut);
         return queue.empty();
     }
 
+    // Number of queued items, read without taking the lock (for monitoring; may be momentarily stale).
+    size_t approx_size() const {
+        return count.load(std::memory_order_relaxed);
+    }
+
 private:
     std::queue<T> queue;
-    mutable std::mutex mut; // Mutex to protect the queue
-    std::condition_variable cond; // Condition variable for waiting
+    mutable CrawlerMutex mut; // Mutex to protect the queue
+    CrawlerCondition cond; // Condition variable for waiting
     bool stop_requested = false; // Flag to signal stopping
+    std::atomic<size_t> count{0}; // Mirror of queue.size(), updated under the lock
+    MemoryAccount* memory = nullptr; // Where queued bytes are reported; null when untracked
 };
 
 #endif // THREAD_SAFE_QUEUE_HPP
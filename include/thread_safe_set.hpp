@@ -4,34 +4,72 @@
 #include <unordered_set>
 #include <mutex>
 #include <string>
+#include <atomic>
+#include <cstddef>
+
+#include "profiled_mutex.hpp"
+#include "memory_budget.hpp"
 
 // A thread-safe set for storing visited URLs.
 class ThreadSafeSet {
 public:
+    // `name` identifies the set's lock in the contention report of a CRAWLER_LOCK_PROFILING build.
+    explicit ThreadSafeSet(const char* name = "ThreadSafeSet") {
+        name_lock(mut, name);
+    }
+
+    // Reports the stored URLs' estimated size into `account` from now on (see MemoryBudget).
+    void track_memory(MemoryAccount* account) {
+        std::lock_guard<CrawlerMutex> lock(mut);
+        memory = account;
+    }
+
     // Attempts to insert a URL into the set.
     // Returns true if insertion occurred (URL was not present).
     // Returns false if the URL was already present.
     bool insert(const std::string& url) {
-        std::lock_guard<std::mutex> lock(mut); // Lock the mutex
+        std::lock_guard<CrawlerMutex> lock(mut); // Lock the mutex
         // try_emplace returns a pair: iterator and bool (true if inserted)
-        return visited_urls.insert(url).second;
+        bool inserted = visited_urls.insert(url).second;
+        if (inserted && memory) memory->add(node_bytes(url));
+        count.store(visited_urls.size(), std::memory_order_relaxed);
+        return inserted;
     } // Mutex is automatically unlocked here
 
+    // Removes a URL from the set so it can be inserted (and crawled) again later.
+    void erase(const std::string& url) {
+        std::lock_guard<CrawlerMutex> lock(mut);
+        if (visited_urls.erase(url) && memory) memory->sub(node_bytes(url));
+        count.store(visited_urls.size(), std::memory_order_relaxed);
+    }
+
     // Checks if a URL is present in the set (thread-safe).
     bool contains(const std::string& url) const {
-        std::lock_guard<std::mutex> lock(mut);
+        std::lock_guard<CrawlerMutex> lock(mut);
         return visited_urls.count(url) > 0;
     }
 
     // Returns the number of items in the set (thread-safe).
     size_t size() const {
-        std::lock_guard<std::mutex> lock(mut);
+        std::lock_guard<CrawlerMutex> lock(mut);
         return visited_urls.size();
     }
 
+    // Number of items, read without taking the lock (for monitoring; may be momentarily stale).
+    size_t approx_size() const {
+        return count.load(std::memory_order_relaxed);
+    }
+
 private:
+    // A hash node (next pointer, cached hash, the string) plus its share of the bucket array
+    static size_t node_bytes(const std::string& url) {
+        return memory_footprint(url) + 2 * sizeof(void*) + sizeof(void*);
+    }
+
     std::unordered_set<std::string> visited_urls;
-    mutable std::mutex mut; // Mutex to protect the set
+    mutable CrawlerMutex mut; // Mutex to protect the set
+    std::atomic<size_t> count{0}; // Mirror of visited_urls.size(), updated under the lock
+    MemoryAccount* memory = nullptr; // Where stored bytes are reported; null when untracked
 };
 
 #endif // THREAD_SAFE_SET_HPP
@@ -0,0 +1,213 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <stdexcept>
+
+// One completed span. `name` must be a string literal (only the pointer is stored).
+struct TraceEvent {
+    const char* name = nullptr;
+    uint64_t start = 0;    // Microseconds since the tracer was created
+    uint64_t duration = 0;
+    std::string url;       // Only set on per-URL root spans
+    int slot = 0;          // 0: the thread's own track; n > 0: the track of the thread's in-flight slot n
+};
+
+// A thread's ring of recent spans. Only the owning thread writes; once full, the oldest spans are
+// overwritten, so a long crawl keeps its last `capacity` spans per thread and memory stays fixed.
+// The URL strings keep their capacity across reuse, so steady-state recording does not allocate.
+class TraceBuffer {
+public:
+    TraceBuffer(int tid, std::string thread_name, size_t capacity, std::chrono::steady_clock::time_point epoch)
+        : tid(tid), thread_name(std::move(thread_name)), events(capacity), mask(capacity - 1), epoch(epoch) {}
+
+    uint64_t now() const {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - epoch).count());
+    }
+
+    uint64_t to_trace_time(std::chrono::steady_clock::time_point t) const {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(t - epoch).count());
+    }
+
+    void add(const char* name, uint64_t start, uint64_t duration, const std::string* url = nullptr, int slot = 0) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        TraceEvent& event = events[h & mask];
+        event.name = name;
+        event.start = start;
+        event.duration = duration;
+        if (url) event.url = *url; else event.url.clear();
+        event.slot = slot;
+        if (slot > slots) slots = slot;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+private:
+    friend class Tracer;
+
+    const int tid;
+    std::string thread_name; // Every thread that used the buffer, in turn
+    std::vector<TraceEvent> events;
+    const uint64_t mask;
+    const std::chrono::steady_clock::time_point epoch;
+    std::atomic<uint64_t> head{0}; // Total spans ever added
+    int slots = 0;                 // Highest in-flight slot any span was recorded on (published by head)
+};
+
+// Collects spans from every registered thread and writes them as a Chrome trace
+// (chrome://tracing, ui.perfetto.dev): one "X" (complete) event per span, one track per thread.
+// Complete events must nest within a track, so the spans of a page a worker overlaps with others
+// (--inflight) go on a track of their own per in-flight slot, listed under the worker's track; a
+// slot only takes a new page once its last one is done, so its spans never overlap.
+//
+// Threads that never register have no buffer, and every recording site first checks the
+// thread-local buffer pointer, so with tracing off the cost is one predictable branch per span.
+class Tracer {
+public:
+    // `capacity` spans per thread, rounded up to a power of two.
+    explicit Tracer(size_t capacity = size_t(1) << 16) : epoch(std::chrono::steady_clock::now()) {
+        buffer_capacity = 1;
+        while (buffer_capacity < capacity) buffer_capacity <<= 1;
+    }
+
+    // Gives the calling thread its own buffer and makes it the target of TraceSpan on this thread.
+    // A buffer released by a thread that has exited is taken over, spans and all: it becomes one
+    // track named after every thread that used it.
+    TraceBuffer& register_thread(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mut);
+        if (!free_buffers.empty()) {
+            TraceBuffer* buffer = free_buffers.back();
+            free_buffers.pop_back();
+            buffer->thread_name += ", " + name;
+            current_buffer() = buffer;
+            return *buffer;
+        }
+        buffers.push_back(std::make_unique<TraceBuffer>(static_cast<int>(buffers.size()) + 1, name,
+                                                        buffer_capacity, epoch));
+        current_buffer() = buffers.back().get();
+        return *buffers.back();
+    }
+
+    // Hands the calling thread's buffer to the next thread that registers, so a pool that keeps
+    // replacing threads does not keep adding buffers. Call last thing before the thread exits.
+    void release_thread() {
+        TraceBuffer*& buffer = current_buffer();
+        if (!buffer) return;
+        std::lock_guard<std::mutex> lock(mut);
+        free_buffers.push_back(buffer);
+        buffer = nullptr;
+    }
+
+    // The calling thread's buffer, or nullptr if it is not being traced.
+    static TraceBuffer* current() { return current_buffer(); }
+
+    // Writes all buffered spans to `path`. Call after the traced threads have finished.
+    // Returns the number of spans written.
+    size_t write(const std::string& path) {
+        std::FILE* out = std::fopen(path.c_str(), "wb");
+        if (!out) {
+            throw std::runtime_error("Cannot open " + path);
+        }
+        std::lock_guard<std::mutex> lock(mut);
+        std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", out);
+        bool first = true;
+        size_t written = 0;
+        // Slot n of buffer b is track b + n * buffers.size(), after every thread's own track
+        const int num_buffers = static_cast<int>(buffers.size());
+        auto track = [num_buffers](const TraceBuffer& buffer, int slot) { return buffer.tid + slot * num_buffers; };
+        int sort_index = 0; // Lists each worker's slot tracks right below its own
+        for (const auto& buffer : buffers) {
+            uint64_t head = buffer->head.load(std::memory_order_acquire);
+            for (int slot = 0; slot <= buffer->slots; ++slot) {
+                std::string name = buffer->thread_name;
+                if (slot > 0) name += " / in-flight " + std::to_string(slot);
+                std::fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                             first ? "" : ",\n", track(*buffer, slot), json_escape(name).c_str());
+                std::fprintf(out, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"sort_index\":%d}}",
+                             track(*buffer, slot), sort_index++);
+                first = false;
+            }
+            uint64_t begin = head > buffer->events.size() ? head - buffer->events.size() : 0;
+            for (uint64_t i = begin; i < head; ++i) {
+                const TraceEvent& event = buffer->events[i & buffer->mask];
+                std::fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%llu,\"dur\":%llu",
+                             event.name, track(*buffer, event.slot), static_cast<unsigned long long>(event.start),
+                             static_cast<unsigned long long>(event.duration));
+                if (!event.url.empty()) {
+                    std::fprintf(out, ",\"args\":{\"url\":\"%s\"}", json_escape(event.url).c_str());
+                }
+                std::fputc('}', out);
+                written++;
+            }
+        }
+        std::fputs("\n]}\n", out);
+        std::fclose(out);
+        return written;
+    }
+
+    static std::string json_escape(const std::string& value) {
+        std::string out;
+        for (unsigned char c : value) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += static_cast<char>(c);
+            } else if (c < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            } else {
+                out += static_cast<char>(c);
+            }
+        }
+        return out;
+    }
+
+private:
+    static TraceBuffer*& current_buffer() {
+        thread_local TraceBuffer* buffer = nullptr;
+        return buffer;
+    }
+
+    const std::chrono::steady_clock::time_point epoch;
+    size_t buffer_capacity;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+    std::vector<TraceBuffer*> free_buffers; // Released by exited threads, waiting for the next one
+    std::mutex mut; // Mutex to protect buffers and free_buffers (taken on registration and when writing)
+};
+
+// Records the enclosing scope (or up to end()) as a span on the calling thread, if it is traced,
+// on the thread's own track or that of in-flight slot `slot`.
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name, const std::string* url = nullptr, int slot = 0)
+        : buffer(Tracer::current()), name(name), url(url), slot(slot) {
+        if (buffer) start = buffer->now();
+    }
+
+    ~TraceSpan() { end(); }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    void end() {
+        if (!buffer) return;
+        buffer->add(name, start, buffer->now() - start, url, slot);
+        buffer = nullptr;
+    }
+
+private:
+    TraceBuffer* buffer;
+    const char* name;
+    const std::string* url;
+    const int slot;
+    uint64_t start = 0;
+};
+
+#endif // TRACE_HPP
@@ -0,0 +1,351 @@
+#ifndef TRAP_DETECTOR_HPP
+#define TRAP_DETECTOR_HPP
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <cctype>
+#include <mutex>
+#include <ostream>
+
+#include "url_utils.hpp"
+#include "content_hash.hpp"
+#include "memory_budget.hpp"
+
+// Detects crawler traps (infinite calendars, ?page=N+1 chains, /a/a/a/a/ recursions, session IDs)
+// before a URL reaches the crawl queue.
+//
+// check() canonicalizes a URL by stripping query parameters that do not change the content, then
+// classifies it:
+//   * Reject  - too deep, or a path segment repeats too often, or its URL pattern is trap-shaped
+//               and over the cap
+//   * Demote  - its URL pattern is trap-shaped and getting large; crawl it only once everything
+//               else is done
+//   * Accept  - everything else
+// A URL pattern is the host, the path with digit runs replaced by 'N', and the sorted parameter
+// names, so /2024/05/17?view=day and /2031/12/01?view=day share a pattern.
+//
+// Only trap-shaped patterns are capped: query parameters, more than one digit run in the path
+// (calendars, /a/1/b/2 chains), a repeated path segment, or a path more than half the maximum
+// depth. A plain numbered catalogue (/item/N, /page/N) is legitimately large and never capped; the
+// visited set and content dedup deal with it. The caps are set with set_pattern_limits()
+// (--trap-demote-after, --trap-max-per-pattern).
+//
+// observe() learns, per host, which query parameters are content-neutral: when two URLs that differ
+// only in the value of parameter p return the same body, p is evidence-of-neutral; once p has
+// enough evidence (and no counter-evidence) it is stripped from future URLs of that host.
+class TrapDetector {
+public:
+    enum class Verdict { Accept, Demote, Reject };
+
+    TrapDetector(size_t max_path_depth = 16,
+                 size_t max_segment_repeats = 2,
+                 size_t demote_after_per_pattern = 200,
+                 size_t max_urls_per_pattern = 1000)
+        : max_path_depth(max_path_depth), max_segment_repeats(max_segment_repeats),
+          demote_after_per_pattern(demote_after_per_pattern),
+          max_urls_per_pattern(max_urls_per_pattern) {}
+
+    // Trap-shaped patterns are demoted past `demote_after` distinct URLs, and rejected past `max_urls`.
+    void set_pattern_limits(size_t demote_after, size_t max_urls) {
+        std::lock_guard<std::mutex> lock(mut);
+        demote_after_per_pattern = demote_after;
+        max_urls_per_pattern = max_urls;
+    }
+
+    // Charges the per-URL bookkeeping (one fingerprint per distinct URL checked, one count per URL
+    // pattern) to `account`. It only grows, like the visited set.
+    void track_memory(MemoryAccount* account) {
+        std::lock_guard<std::mutex> lock(mut);
+        memory = account;
+    }
+
+    // Canonicalizes `url` in place and returns what to do with it.
+    Verdict check(std::string& url) {
+        std::string host = extract_host(url);
+        ParsedUrl parsed = split(url);
+
+        std::lock_guard<std::mutex> lock(mut);
+        strip_neutral_params(host, parsed);
+        url = parsed.join();
+
+        // --- Path shape heuristics ---
+        std::vector<std::string> segments = split_path(parsed.path);
+        if (segments.size() > max_path_depth) {
+            rejected_depth++;
+            return Verdict::Reject;
+        }
+        std::unordered_map<std::string, size_t> segment_counts;
+        bool repeated_segment = false;
+        for (const std::string& segment : segments) {
+            size_t repeats = ++segment_counts[segment];
+            if (repeats > max_segment_repeats) {
+                rejected_repeats++;
+                return Verdict::Reject;
+            }
+            repeated_segment = repeated_segment || repeats > 1;
+        }
+
+        // --- Per-pattern cap (counted once per distinct URL) ---
+        if (!seen_urls.insert(content_hash(url)).second) {
+            return Verdict::Accept; // Already counted; the visited set will deal with it
+        }
+        auto [pattern, added] = pattern_counts.try_emplace(pattern_of(host, parsed), 0);
+        if (memory) {
+            memory->add(static_cast<int64_t>(SEEN_URL_BYTES + (added ? pattern_bytes(pattern->first) : 0)));
+        }
+        size_t count = ++pattern->second;
+        bool trap_shaped = !parsed.params.empty() || repeated_segment || segments.size() > max_path_depth / 2 ||
+                           digit_runs(parsed.path) > 1;
+        if (!trap_shaped) {
+            return Verdict::Accept;
+        }
+        if (count > max_urls_per_pattern) {
+            rejected_pattern++;
+            return Verdict::Reject;
+        }
+        if (count > demote_after_per_pattern) {
+            demoted++;
+            return Verdict::Demote;
+        }
+        return Verdict::Accept;
+    }
+
+    // Records the content fingerprint of a fetched URL, to learn content-neutral parameters.
+    void observe(const std::string& url, uint64_t body_hash) {
+        ParsedUrl parsed = split(url);
+        if (parsed.params.empty()) {
+            return;
+        }
+        std::string host = extract_host(url);
+
+        std::lock_guard<std::mutex> lock(mut);
+        for (size_t i = 0; i < parsed.params.size(); ++i) {
+            const std::string& name = parsed.params[i].first;
+            const std::string& value = parsed.params[i].second;
+            // The URL with parameter i removed identifies "the same page, any value of `name`"
+            ParsedUrl without = parsed;
+            without.params.erase(without.params.begin() + i);
+            std::string key = name + '\n' + without.join();
+
+            auto it = param_samples.find(key);
+            if (it == param_samples.end()) {
+                if (param_samples.size() < MAX_PARAM_SAMPLES) {
+                    param_samples.emplace(key, Sample{body_hash, value});
+                }
+                continue;
+            }
+            if (it->second.value == value) {
+                continue; // Same URL fetched again, tells us nothing
+            }
+            ParamEvidence& evidence = host_params[host][name];
+            if (it->second.body_hash == body_hash) {
+                evidence.same_content++;
+            } else {
+                evidence.different_content++;
+            }
+        }
+    }
+
+    // Total number of URLs demoted so far.
+    size_t demoted_count() const {
+        std::lock_guard<std::mutex> lock(mut);
+        return demoted;
+    }
+
+    void report(std::ostream& out) const {
+        std::lock_guard<std::mutex> lock(mut);
+        out << "--- Crawler Traps ---" << std::endl;
+        out << "  Rejected (too deep): " << rejected_depth << std::endl;
+        out << "  Rejected (repeated path segments): " << rejected_repeats << std::endl;
+        out << "  Rejected (trap-shaped URL pattern over " << max_urls_per_pattern << "): " << rejected_pattern << std::endl;
+        out << "  Demoted (trap-shaped URL pattern over " << demote_after_per_pattern << "): " << demoted << std::endl;
+        for (const auto& [host, params] : host_params) {
+            for (const auto& [name, evidence] : params) {
+                if (is_neutral(evidence)) {
+                    out << "  Ignoring parameter '" << name << "' on " << host << std::endl;
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr size_t MAX_PARAM_SAMPLES = 200000; // Bounds the memory used for learning
+    static constexpr int NEUTRAL_EVIDENCE = 2;          // Same-content observations needed to strip
+    // Estimated heap bytes per seen_urls entry: node (next pointer and value) and bucket pointer
+    static constexpr size_t SEEN_URL_BYTES = sizeof(void*) + sizeof(uint64_t) + sizeof(void*);
+
+    // Estimated heap bytes per pattern_counts entry: node (next pointer, key, count, cached hash)
+    // and bucket pointer
+    static size_t pattern_bytes(const std::string& pattern) {
+        return memory_footprint(pattern) + sizeof(size_t) + 3 * sizeof(void*);
+    }
+
+    struct ParsedUrl {
+        std::string base; // Scheme, authority and path
+        std::string path;
+        std::vector<std::pair<std::string, std::string>> params;
+
+        std::string join() const {
+            std::string url = base;
+            for (size_t i = 0; i < params.size(); ++i) {
+                url += (i == 0 ? '?' : '&');
+                url += params[i].first;
+                if (!params[i].second.empty()) {
+                    url += '=';
+                    url += params[i].second;
+                }
+            }
+            return url;
+        }
+    };
+
+    struct Sample {
+        uint64_t body_hash;
+        std::string value;
+    };
+
+    struct ParamEvidence {
+        int same_content = 0;
+        int different_content = 0;
+    };
+
+    static bool is_neutral(const ParamEvidence& evidence) {
+        return evidence.same_content >= NEUTRAL_EVIDENCE && evidence.different_content == 0;
+    }
+
+    // Session and tracking parameters that never change content, on any host.
+    static bool is_known_neutral(std::string name) {
+        for (char& c : name) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        static const std::unordered_set<std::string> names = {
+            "sid", "session", "sessionid", "session_id", "jsessionid", "phpsessid", "aspsessionid",
+            "utm_source", "utm_medium", "utm_campaign", "utm_term", "utm_content", "fbclid", "gclid",
+        };
+        return names.count(name) > 0;
+    }
+
+    static ParsedUrl split(const std::string& url) {
+        ParsedUrl parsed;
+        size_t query_pos = url.find('?');
+        parsed.base = url.substr(0, query_pos);
+
+        size_t authority = parsed.base.find("//");
+        authority = authority == std::string::npos ? 0 : authority + 2;
+
+        // Drop ";jsessionid=..." style path parameters
+        size_t semicolon = parsed.base.find(';', authority);
+        if (semicolon != std::string::npos) {
+            parsed.base.erase(semicolon);
+        }
+
+        size_t path_start = parsed.base.find('/', authority);
+        parsed.path = path_start == std::string::npos ? "/" : parsed.base.substr(path_start);
+
+        if (query_pos != std::string::npos) {
+            size_t pos = query_pos + 1;
+            while (pos <= url.size()) {
+                size_t amp = url.find('&', pos);
+                if (amp == std::string::npos) amp = url.size();
+                std::string param = url.substr(pos, amp - pos);
+                if (!param.empty()) {
+                    size_t eq = param.find('=');
+                    if (eq == std::string::npos) {
+                        parsed.params.emplace_back(param, "");
+                    } else {
+                        parsed.params.emplace_back(param.substr(0, eq), param.substr(eq + 1));
+                    }
+                }
+                pos = amp + 1;
+            }
+        }
+        return parsed;
+    }
+
+    static std::vector<std::string> split_path(const std::string& path) {
+        std::vector<std::string> segments;
+        size_t pos = 0;
+        while (pos < path.size()) {
+            size_t slash = path.find('/', pos);
+            if (slash == std::string::npos) slash = path.size();
+            if (slash > pos) {
+                segments.push_back(path.substr(pos, slash - pos));
+            }
+            pos = slash + 1;
+        }
+        return segments;
+    }
+
+    static size_t digit_runs(const std::string& path) {
+        size_t runs = 0;
+        bool in_digits = false;
+        for (char c : path) {
+            bool digit = std::isdigit(static_cast<unsigned char>(c)) != 0;
+            runs += digit && !in_digits;
+            in_digits = digit;
+        }
+        return runs;
+    }
+
+    static std::string pattern_of(const std::string& host, const ParsedUrl& parsed) {
+        std::string pattern = host;
+        bool in_digits = false;
+        for (char c : parsed.path) {
+            if (std::isdigit(static_cast<unsigned char>(c))) {
+                if (!in_digits) pattern.push_back('N');
+                in_digits = true;
+            } else {
+                pattern.push_back(c);
+                in_digits = false;
+            }
+        }
+        std::vector<std::string> names;
+        for (const auto& param : parsed.params) {
+            names.push_back(param.first);
+        }
+        std::sort(names.begin(), names.end());
+        for (const std::string& name : names) {
+            pattern += '?';
+            pattern += name;
+        }
+        return pattern;
+    }
+
+    // Must be called with `mut` held.
+    void strip_neutral_params(const std::string& host, ParsedUrl& parsed) const {
+        auto learned = host_params.find(host);
+        parsed.params.erase(std::remove_if(parsed.params.begin(), parsed.params.end(),
+            [&](const std::pair<std::string, std::string>& param) {
+                if (is_known_neutral(param.first)) {
+                    return true;
+                }
+                if (learned == host_params.end()) {
+                    return false;
+                }
+                auto it = learned->second.find(param.first);
+                return it != learned->second.end() && is_neutral(it->second);
+            }), parsed.params.end());
+    }
+
+    const size_t max_path_depth;
+    const size_t max_segment_repeats;
+    size_t demote_after_per_pattern;
+    size_t max_urls_per_pattern;
+
+    std::unordered_set<uint64_t> seen_urls;                      // Fingerprints of URLs already counted
+    std::unordered_map<std::string, size_t> pattern_counts;      // Distinct URLs per URL pattern
+    std::unordered_map<std::string, Sample> param_samples;       // One observed fetch per (param, rest-of-URL)
+    std::unordered_map<std::string, std::unordered_map<std::string, ParamEvidence>> host_params;
+
+    size_t rejected_depth = 0;
+    size_t rejected_repeats = 0;
+    size_t rejected_pattern = 0;
+    size_t demoted = 0;
+    MemoryAccount* memory = nullptr; // Where seen_urls and pattern_counts are charged, if anywhere
+    mutable std::mutex mut; // Mutex to protect all of the above
+};
+
+#endif // TRAP_DETECTOR_HPP
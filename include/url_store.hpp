@@ -0,0 +1,172 @@
+#ifndef URL_STORE_HPP
+#define URL_STORE_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+#include "content_hash.hpp"
+#include "mapped_file.hpp"
+
+// On-disk layout of a URL status table (<index dir>/urls.tbl):
+//
+//   UrlTableHeader                  32 bytes
+//   UrlTableEntry entries[count]    sorted by (fingerprint, URL)
+//   char          url_bytes[]
+//
+// The fingerprint is content_hash(url), so a lookup is a binary search over fixed-size entries
+// followed by one string compare (more only on a 64-bit collision).
+struct UrlTableHeader {
+    char magic[8];          // "CRWLURLS"
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t url_bytes_pos;
+};
+static_assert(sizeof(UrlTableHeader) == 32, "UrlTableHeader must stay 32 bytes");
+
+struct UrlTableEntry {
+    uint64_t fingerprint;
+    uint64_t url_offset;    // Into url_bytes
+    uint32_t url_length;
+    int32_t status;         // HTTP status code, or -CURLcode if the fetch itself failed
+};
+
+constexpr uint32_t URL_TABLE_VERSION = 1;
+
+class UrlStatusView;
+
+// Records the outcome of every fetch while the crawl runs. Sharded like LinkGraph's ID map, so
+// workers recording different URLs rarely meet on a lock.
+class UrlStatusTable {
+public:
+    void record(const std::string& url, int status) {
+        Shard& shard = shards[content_hash(url) >> (64 - SHARD_BITS)];
+        std::lock_guard<std::mutex> lock(shard.mut);
+        shard.statuses[url] = status;
+    }
+
+    size_t size() {
+        size_t total = 0;
+        for (Shard& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mut);
+            total += shard.statuses.size();
+        }
+        return total;
+    }
+
+    // Takes over every entry of an existing table, e.g. the one an earlier crawl left in the index
+    // directory. URLs recorded later overwrite these.
+    void load(const UrlStatusView& table);
+
+    // Writes the sorted table to `path`. Returns the number of URLs written.
+    uint64_t write(const std::string& path) {
+        std::vector<std::pair<uint64_t, const std::pair<const std::string, int32_t>*>> order;
+        for (Shard& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mut);
+            for (const auto& item : shard.statuses) {
+                order.emplace_back(content_hash(item.first), &item);
+            }
+        }
+        std::sort(order.begin(), order.end(), [](const auto& a, const auto& b) {
+            return a.first != b.first ? a.first < b.first : a.second->first < b.second->first;
+        });
+
+        std::vector<UrlTableEntry> entries(order.size());
+        std::string url_bytes;
+        for (size_t i = 0; i < order.size(); ++i) {
+            const std::string& url = order[i].second->first;
+            entries[i].fingerprint = order[i].first;
+            entries[i].url_offset = url_bytes.size();
+            entries[i].url_length = static_cast<uint32_t>(url.size());
+            entries[i].status = order[i].second->second;
+            url_bytes += url;
+        }
+
+        UrlTableHeader header{};
+        std::memcpy(header.magic, "CRWLURLS", 8);
+        header.version = URL_TABLE_VERSION;
+        header.count = entries.size();
+        header.url_bytes_pos = sizeof(UrlTableHeader) + entries.size() * sizeof(UrlTableEntry);
+
+        std::FILE* out = std::fopen(path.c_str(), "wb");
+        if (!out) {
+            throw std::runtime_error("Cannot open " + path);
+        }
+        std::fwrite(&header, sizeof(header), 1, out);
+        std::fwrite(entries.data(), sizeof(UrlTableEntry), entries.size(), out);
+        std::fwrite(url_bytes.data(), 1, url_bytes.size(), out);
+        std::fclose(out);
+        return entries.size();
+    }
+
+private:
+    static constexpr int SHARD_BITS = 6;
+
+    struct Shard {
+        std::unordered_map<std::string, int32_t> statuses;
+        std::mutex mut; // Mutex to protect this shard
+    };
+
+    std::array<Shard, 1 << SHARD_BITS> shards;
+};
+
+// Read-only, mmap'd view of a URL status table.
+class UrlStatusView {
+public:
+    explicit UrlStatusView(const std::string& path) : file(path) {
+        if (file.size() < sizeof(UrlTableHeader)) {
+            throw std::runtime_error(path + " is not a URL table");
+        }
+        header = reinterpret_cast<const UrlTableHeader*>(file.data());
+        if (std::memcmp(header->magic, "CRWLURLS", 8) != 0 || header->version != URL_TABLE_VERSION ||
+            header->url_bytes_pos > file.size()) {
+            throw std::runtime_error(path + " is not a valid URL table");
+        }
+        entries = reinterpret_cast<const UrlTableEntry*>(file.data() + sizeof(UrlTableHeader));
+        url_bytes = reinterpret_cast<const char*>(file.data() + header->url_bytes_pos);
+    }
+
+    uint64_t size() const { return header->count; }
+
+    // Calls f(url, status) for every entry, in table order.
+    template <typename F>
+    void for_each(F&& f) const {
+        for (uint64_t i = 0; i < header->count; ++i) {
+            f(std::string(url_bytes + entries[i].url_offset, entries[i].url_length), entries[i].status);
+        }
+    }
+
+    // Returns the entry for `url`, or nullptr if it was never fetched.
+    const UrlTableEntry* find(const std::string& url) const {
+        uint64_t fingerprint = content_hash(url);
+        const UrlTableEntry* end = entries + header->count;
+        const UrlTableEntry* it = std::lower_bound(entries, end, fingerprint,
+            [](const UrlTableEntry& entry, uint64_t fp) { return entry.fingerprint < fp; });
+        for (; it != end && it->fingerprint == fingerprint; ++it) {
+            if (it->url_length == url.size() && std::memcmp(url_bytes + it->url_offset, url.data(), url.size()) == 0) {
+                return it;
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    MappedFile file;
+    const UrlTableHeader* header = nullptr;
+    const UrlTableEntry* entries = nullptr;
+    const char* url_bytes = nullptr;
+};
+
+inline void UrlStatusTable::load(const UrlStatusView& table) {
+    table.for_each([this](const std::string& url, int32_t status) { record(url, status); });
+}
+
+#endif // URL_STORE_HPP
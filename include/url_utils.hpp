@@ -0,0 +1,26 @@
+#ifndef URL_UTILS_HPP
+#define URL_UTILS_HPP
+
+#include <string>
+#include <cctype>
+
+// Small URL helpers shared by the crawler components.
+// Like resolve_url, these are deliberately simple string operations, not a full URL parser.
+
+// Returns the authority part of a URL, lower-cased (e.g. "https://WWW.Example.com:8080/a" -> "www.example.com:8080").
+// Returns an empty string if the URL has no "//" separator.
+inline std::string extract_host(const std::string& url) {
+    size_t start = url.find("//");
+    if (start == std::string::npos) {
+        return "";
+    }
+    start += 2;
+    size_t end = url.find_first_of("/?#", start);
+    std::string host = url.substr(start, end == std::string::npos ? std::string::npos : end - start);
+    for (char& c : host) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return host;
+}
+
+#endif // URL_UTILS_HPP
@@ -0,0 +1,35 @@
+#ifndef VARINT_HPP
+#define VARINT_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// LEB128-style variable-byte integers: 7 bits per byte, high bit set on every byte but the last.
+// Small numbers (like the gaps between sorted IDs) take one or two bytes.
+
+// Appends `value` to `out`.
+inline void put_varint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+// Decodes one varint starting at `p`, advancing `p` past it.
+// The caller must guarantee that a complete varint is readable.
+inline uint64_t get_varint(const unsigned char*& p) {
+    uint64_t value = 0;
+    int shift = 0;
+    while (*p & 0x80) {
+        value |= static_cast<uint64_t>(*p & 0x7F) << shift;
+        shift += 7;
+        ++p;
+    }
+    value |= static_cast<uint64_t>(*p) << shift;
+    ++p;
+    return value;
+}
+
+#endif // VARINT_HPP
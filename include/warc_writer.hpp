@@ -0,0 +1,335 @@
+#ifndef WARC_WRITER_HPP
+#define WARC_WRITER_HPP
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdio>
+#include <ctime>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <stdexcept>
+#include <cctype>
+#include <zlib.h>
+
+// Writes fetched pages to WARC/1.1 files (ISO 28500), one gzip member per record, so any record
+// can be located and decompressed on its own.
+//
+// Workers build and compress their records themselves (that parallelizes across fetch threads) and
+// hand the compressed bytes over under a short lock. A dedicated writer thread takes the whole
+// pending batch at once and does all file I/O, so a slow disk never stalls a fetch. Files are
+// rotated once they exceed max_file_bytes; each file starts with a warcinfo record.
+//
+// The first file is opened by the constructor, which throws if it cannot be. After that, a write,
+// flush or rotation that fails stops archiving for the rest of the crawl: later exchanges are
+// dropped and error() says why. Only records that reached the file count in records_written().
+class WarcWriter {
+public:
+    WarcWriter(const std::string& prefix, size_t max_file_bytes = size_t(1) << 30,
+               size_t max_pending_bytes = size_t(64) << 20)
+        : prefix(prefix), max_file_bytes(max_file_bytes), max_pending_bytes(max_pending_bytes) {
+        open_next_file();
+        writer = std::thread(&WarcWriter::writer_loop, this);
+    }
+
+    ~WarcWriter() {
+        close();
+    }
+
+    // Writes out everything still pending, stops the writer thread and closes the current file.
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            stop_requested = true;
+        }
+        cond.notify_all();
+        space_cond.notify_all();
+        if (writer.joinable()) {
+            writer.join();
+        }
+        if (file) {
+            std::fclose(file);
+            file = nullptr;
+        }
+    }
+
+    WarcWriter(const WarcWriter&) = delete;
+    WarcWriter& operator=(const WarcWriter&) = delete;
+
+    // Archives one HTTP exchange as request, response and (if `metadata` is not empty) metadata records.
+    // `request_headers` and `response_headers` are the raw header blocks, including the final blank line.
+    // `body` is the payload as curl delivered it, so the response headers are rewritten to match (see
+    // payload_headers).
+    void write_exchange(const std::string& url,
+                        const std::string& request_headers,
+                        const std::string& response_headers,
+                        const std::string& body,
+                        const std::vector<std::pair<std::string, std::string>>& metadata) {
+        if (failed.load(std::memory_order_relaxed)) return; // Archiving stopped: skip the compression too
+        std::string date = warc_date();
+        std::string response_id = record_id();
+
+        std::string compressed;
+        int records = 1;
+        if (!request_headers.empty()) {
+            compressed += gzip_member(record("request", url, date, record_id(), response_id,
+                                             "application/http;msgtype=request", request_headers));
+            records++;
+        }
+        compressed += gzip_member(record("response", url, date, response_id, "",
+                                         "application/http;msgtype=response",
+                                         payload_headers(response_headers, body.size()) + body));
+        if (!metadata.empty()) {
+            std::string fields;
+            for (const auto& [name, value] : metadata) {
+                fields += name + ": " + value + "\r\n";
+            }
+            compressed += gzip_member(record("metadata", url, date, record_id(), response_id,
+                                             "application/warc-fields", fields));
+            records++;
+        }
+        enqueue(std::move(compressed), records);
+    }
+
+    // `headers` rewritten for a body of `body_size` bytes with the transfer coding removed: curl always
+    // de-chunks, so Transfer-Encoding no longer applies and the server's Content-Length (if any) may be
+    // missing. Both originals are kept as X-Archive-Orig-* headers, and a Content-Length for the archived
+    // body is added. Content-Encoding stays: the fetchers never set CURLOPT_ACCEPT_ENCODING, so a body
+    // the server compressed anyway is archived compressed, as that header says.
+    static std::string payload_headers(const std::string& headers, size_t body_size) {
+        std::string out;
+        size_t pos = 0;
+        while (pos < headers.size()) {
+            size_t eol = headers.find('\n', pos);
+            size_t next = eol == std::string::npos ? headers.size() : eol + 1;
+            std::string line = headers.substr(pos, next - pos);
+            pos = next;
+            size_t content_end = line.find_last_not_of("\r\n");
+            if (content_end == std::string::npos) break; // The blank line ending the block
+            line.resize(content_end + 1);
+            size_t colon = line.find(':');
+            std::string name = colon == std::string::npos ? "" : line.substr(0, colon);
+            for (char& c : name) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            if (name == "transfer-encoding" || name == "content-length") {
+                out += "X-Archive-Orig-" + line + "\r\n";
+            } else {
+                out += line + "\r\n";
+            }
+        }
+        if (out.empty()) return headers; // No header block (a fetcher that does not capture one)
+        out += "Content-Length: " + std::to_string(body_size) + "\r\n\r\n";
+        return out;
+    }
+
+    // Compressed bytes written to disk so far (all files).
+    size_t bytes_written() const { return written_bytes.load(std::memory_order_relaxed); }
+    size_t records_written() const { return written_records.load(std::memory_order_relaxed); }
+    int files_written() const { return file_index.load(std::memory_order_relaxed); }
+
+    // Why archiving stopped, or empty while it is still running.
+    std::string error() const {
+        std::lock_guard<std::mutex> lock(mut);
+        return failure;
+    }
+
+private:
+    struct Pending {
+        std::string data;
+        int records;
+    };
+
+    void enqueue(std::string compressed, int records) {
+        std::unique_lock<std::mutex> lock(mut);
+        // Bounded hand-off: only if the disk falls far behind does a worker wait here
+        space_cond.wait(lock, [this] { return pending_bytes < max_pending_bytes || stop_requested || !failure.empty(); });
+        if (!failure.empty()) return;
+        pending_bytes += compressed.size();
+        pending.push_back(Pending{std::move(compressed), records});
+        if (pending_bytes >= BATCH_BYTES) {
+            cond.notify_one();
+        }
+    }
+
+    void writer_loop() {
+        std::vector<Pending> batch;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mut);
+                // Wake up for a full batch, or every 100ms so small crawls still reach disk
+                cond.wait_for(lock, std::chrono::milliseconds(100),
+                              [this] { return pending_bytes >= BATCH_BYTES || stop_requested; });
+                batch.swap(pending);
+                pending_bytes = 0;
+                if (batch.empty() && stop_requested) {
+                    break;
+                }
+            }
+            space_cond.notify_all();
+
+            // After a failure the batches are only drained, so workers never wait for room
+            for (const Pending& item : batch) {
+                if (failed.load(std::memory_order_relaxed)) break;
+                try {
+                    if (current_file_bytes > 0 && current_file_bytes + item.data.size() > max_file_bytes) {
+                        open_next_file();
+                    }
+                    if (!write_raw(item.data)) {
+                        throw std::runtime_error("Cannot write to WARC file " + current_name);
+                    }
+                    written_records.fetch_add(item.records, std::memory_order_relaxed);
+                } catch (const std::exception& e) {
+                    fail(e.what());
+                }
+            }
+            if (!batch.empty() && !failed.load(std::memory_order_relaxed) && std::fflush(file) != 0) {
+                fail("Cannot flush WARC file " + current_name);
+            }
+            batch.clear();
+        }
+    }
+
+    // Closes the current file and starts the next one. Throws if either fails.
+    void open_next_file() {
+        if (file) {
+            int closed = std::fclose(file);
+            file = nullptr;
+            if (closed != 0) {
+                throw std::runtime_error("Cannot close WARC file " + current_name);
+            }
+        }
+        char name_suffix[32];
+        std::snprintf(name_suffix, sizeof(name_suffix), "-%05d.warc.gz", file_index.load());
+        std::string filename = prefix + name_suffix;
+        file = std::fopen(filename.c_str(), "wb");
+        if (!file) {
+            throw std::runtime_error("Cannot open WARC file " + filename);
+        }
+        file_index++;
+        current_file_bytes = 0;
+        current_name = filename;
+
+        std::string fields = "software: MySimpleCrawler/1.0\r\n"
+                             "format: WARC File Format 1.1\r\n"
+                             "conformsTo: http://iipc.github.io/warc-specifications/specifications/warc-format/warc-1.1/\r\n";
+        std::string basename = filename.substr(filename.find_last_of("/\\") + 1);
+        if (!write_raw(gzip_member(record("warcinfo", "", warc_date(), record_id(), "",
+                                          "application/warc-fields", fields, basename)))) {
+            throw std::runtime_error("Cannot write to WARC file " + filename);
+        }
+        written_records.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // False if not all of `data` was written.
+    bool write_raw(const std::string& data) {
+        size_t written = std::fwrite(data.data(), 1, data.size(), file);
+        current_file_bytes += written;
+        written_bytes.fetch_add(written, std::memory_order_relaxed);
+        return written == data.size();
+    }
+
+    // Stops archiving: whatever is pending or submitted later is dropped.
+    void fail(const std::string& message) {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            failure = message;
+            failed.store(true, std::memory_order_relaxed);
+        }
+        space_cond.notify_all();
+    }
+
+    static std::string record(const std::string& type, const std::string& target_uri,
+                              const std::string& date, const std::string& id,
+                              const std::string& concurrent_to, const std::string& content_type,
+                              const std::string& block, const std::string& filename = "") {
+        std::string out = "WARC/1.1\r\n";
+        out += "WARC-Type: " + type + "\r\n";
+        out += "WARC-Record-ID: " + id + "\r\n";
+        out += "WARC-Date: " + date + "\r\n";
+        if (!target_uri.empty()) out += "WARC-Target-URI: " + target_uri + "\r\n";
+        if (!concurrent_to.empty()) out += "WARC-Concurrent-To: " + concurrent_to + "\r\n";
+        if (!filename.empty()) out += "WARC-Filename: " + filename + "\r\n";
+        out += "Content-Type: " + content_type + "\r\n";
+        out += "Content-Length: " + std::to_string(block.size()) + "\r\n\r\n";
+        out += block;
+        out += "\r\n\r\n";
+        return out;
+    }
+
+    // Compresses `data` into a single, self-contained gzip member.
+    static std::string gzip_member(const std::string& data) {
+        z_stream stream{};
+        // windowBits 15 + 16 selects the gzip wrapper instead of zlib's
+        if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::runtime_error("deflateInit2 failed");
+        }
+        std::string out(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        stream.avail_in = static_cast<uInt>(data.size());
+        stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+        stream.avail_out = static_cast<uInt>(out.size());
+        deflate(&stream, Z_FINISH);
+        out.resize(stream.total_out);
+        deflateEnd(&stream);
+        return out;
+    }
+
+    static std::string warc_date() {
+        std::time_t now = std::time(nullptr);
+        std::tm utc{};
+#ifdef _WIN32
+        gmtime_s(&utc, &now);
+#else
+        gmtime_r(&now, &utc);
+#endif
+        char buffer[32];
+        std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", &utc);
+        return buffer;
+    }
+
+    // A random (version 4) UUID in the <urn:uuid:...> form WARC uses for record IDs.
+    static std::string record_id() {
+        thread_local std::mt19937_64 rng(std::random_device{}() ^
+                                         std::hash<std::thread::id>{}(std::this_thread::get_id()));
+        uint64_t hi = rng();
+        uint64_t lo = rng();
+        hi = (hi & 0xFFFFFFFFFFFF0FFFULL) | 0x0000000000004000ULL; // Version 4
+        lo = (lo & 0x3FFFFFFFFFFFFFFFULL) | 0x8000000000000000ULL; // RFC 4122 variant
+        char buffer[64];
+        std::snprintf(buffer, sizeof(buffer), "<urn:uuid:%08x-%04x-%04x-%04x-%012llx>",
+                      static_cast<unsigned>(hi >> 32), static_cast<unsigned>((hi >> 16) & 0xFFFF),
+                      static_cast<unsigned>(hi & 0xFFFF), static_cast<unsigned>(lo >> 48),
+                      static_cast<unsigned long long>(lo & 0xFFFFFFFFFFFFULL));
+        return buffer;
+    }
+
+    static constexpr size_t BATCH_BYTES = size_t(1) << 20; // Wake the writer once this much is pending
+
+    const std::string prefix;
+    const size_t max_file_bytes;
+    const size_t max_pending_bytes;
+
+    // Owned by the writer thread (and the constructor, before it starts)
+    std::FILE* file = nullptr;
+    std::string current_name;
+    size_t current_file_bytes = 0;
+
+    std::vector<Pending> pending;
+    size_t pending_bytes = 0;
+    bool stop_requested = false;
+    std::string failure;                 // Why archiving stopped
+    std::atomic<bool> failed{false};     // !failure.empty(), for checks without the lock
+    mutable std::mutex mut;              // Mutex to protect pending, pending_bytes, stop_requested and failure
+    std::condition_variable cond;        // Wakes the writer thread
+    std::condition_variable space_cond;  // Wakes workers waiting for room in the pending batch
+    std::thread writer;
+
+    std::atomic<size_t> written_bytes{0};
+    std::atomic<size_t> written_records{0};
+    std::atomic<int> file_index{0};
+};
+
+#endif // WARC_WRITER_HPP
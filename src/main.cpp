@@ -6,236 +6,1387 @@
 #include <chrono> // For std::chrono::seconds
 #include <optional>
 #include <set>    // For basic URL processing
+#include <memory> // For std::unique_ptr
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+#include <cstdio>
 #include <curl/curl.h>
 #include <gumbo.h>
 
 // Include our thread-safe classes
 #include "thread_safe_queue.hpp"
 #include "thread_safe_set.hpp"
+#include "circuit_breaker.hpp"
+#include "url_utils.hpp"
+#include "link_extractor.hpp"
+#include "content_hash.hpp"
+#include "simhash.hpp"
+#include "page_text.hpp"
+#include "trap_detector.hpp"
+#include "warc_writer.hpp"
+#include "link_graph.hpp"
+#include "pagerank.hpp"
+#include "inverted_index.hpp"
+#include "index_query.hpp"
+#include "url_store.hpp"
+#include "latency_histogram.hpp"
+#include "crawl_stats.hpp"
+#include "metrics_server.hpp"
+#include "trace.hpp"
+#include "async_logger.hpp"
+#include "replay_store.hpp"
+#include "fetcher.hpp"
+#include "curl_fetcher.hpp"
+#include "replay_fetcher.hpp"
+#include "mock_fetcher.hpp"
+#include "crawl_simulator.hpp"
+#include "concurrency_tuner.hpp"
+#include "memory_budget.hpp"
+#include "frontier_spill.hpp"
+#include "arena.hpp"
+#include "gumbo_arena.hpp"
+#include "thread_affinity.hpp"
 
 // --- Global Shared Data ---
 // These are declared globally or passed around so all threads can access them
-ThreadSafeQueue<std::string> url_queue;
-ThreadSafeSet visited_urls;
+ThreadSafeQueue<std::string> url_queue("url_queue");
+ThreadSafeSet visited_urls("visited_urls");
+ThreadSafeQueue<std::string> demoted_queue("demoted_queue"); // Suspected trap URLs, crawled only when url_queue runs dry
 std::atomic<int> active_workers = 0; // Count of threads actively fetching/parsing
-const int NUM_THREADS = 4;           // Number of worker threads to create
+int num_threads = 4;                 // Number of worker threads to create (--threads)
+bool auto_threads = false;           // --threads auto: let the ConcurrencyTuner pick the count at runtime
+int max_threads = 256;               // --max-threads: ceiling for the tuner
+std::atomic<int> worker_target = 0;  // Workers the pool should have; changes only with --threads auto
+std::atomic<int> retire_requests = 0; // Workers asked to exit after their current page (pool shrinking)
+std::atomic<int> live_workers = 0;   // Worker threads running
+std::vector<std::thread::id> exited_workers; // Workers that have finished and only need joining
+std::mutex exited_mut;                       // Mutex to protect exited_workers
+std::atomic<uint64_t> fetch_micros = 0; // Time all workers spent waiting on their transport, for the tuner's I/O wait
+
+TrapDetector trap_detector;            // Screens every discovered link before it is enqueued
+CircuitBreaker host_breaker;           // Parks URLs of hosts that keep failing to connect or timing out
+FingerprintStore content_fingerprints; // Hashes of every HTML body seen, to skip exact duplicates
+SimHashIndex near_duplicate_index;     // SimHashes of page text, to skip outlinks of near-duplicates
+StageTimings stage_timings;            // Per-thread latency histograms of every fetch/parse stage
+CrawlStats crawl_stats;                // Response, byte, error and in-flight counts for the metrics endpoint
+std::unique_ptr<WarcWriter> warc_writer; // Archives every fetched response; null unless --warc is given
+std::unique_ptr<LinkGraph> link_graph;   // Records every extracted link; null unless --graph is given
+std::unique_ptr<IndexWriter> page_index; // Full-text index of crawled pages; null unless --index is given
+std::unique_ptr<UrlStatusTable> url_statuses; // Outcome of every fetch, stored next to the index
+std::unique_ptr<Tracer> tracer;          // Per-worker span timeline; null unless --trace is given
+AsyncLogger logger;                      // Workers log through this instead of std::cout/std::cerr
+MemoryBudget memory_budget;              // Estimated memory per component, and the pressure that follows from it
+std::unique_ptr<FrontierSpill> frontier_spill; // Frontier overflow on disk; null unless --memory-budget-mb
+std::unique_ptr<ReplayStore> replay_store; // Recorded responses for the replay transport; null unless --replay
+CpuAffinity cpu_affinity;                // --affinity: the CPU each worker is pinned to (none by default)
+PlacementTable worker_placements;        // Where every worker ran, for the final report and --stats-json
+WorkerSlots worker_slots;                // Worker IDs, handed back by exiting workers for the next one
+
+// Transport every worker fetches through (--transport): curl easy, curl multi, replay or mock
+std::string transport = "easy";
+ReplayLatency replay_latency = ReplayLatency::Zero; // --replay-latency
+int replay_latency_ms = 0;                          // Mean for ReplayLatency::Synthetic
+uint64_t mock_pages = 100000;                       // --mock-pages: size of the mock transport's site
+int mock_latency_ms = 0;                            // --mock-latency-ms: delay of every mock response
+int inflight_per_worker = 8;                        // --inflight: transfers a worker overlaps (not with easy)
+
+const int MAX_REDIRECTS = 10;        // Redirect hops followed per URL
+const int TRANSPORT_POLL_MS = 50;    // Longest a worker with pages in flight waits before checking the queue again
+const int DEMOTED_BATCH = 100;       // Demoted URLs the monitor moves back to url_queue per tick if every worker is idle
+const size_t SPILL_KEEP = 10000;     // URLs left in memory when the frontier spills, and read back per refill
+const size_t PARSE_ARENA_BLOCK = 256 * 1024;          // Growth step of a worker's gumbo arena
+const size_t PARSE_ARENA_RETAIN = size_t(16) << 20;   // Gumbo arena memory a worker keeps between pages
+const size_t INDEX_FLUSH_UNDER_PRESSURE = size_t(1) << 20; // Index buffers above this are flushed under pressure
+
+std::atomic<long> near_duplicates = 0;        // Pages whose outlinks were skipped as near-duplicates
+std::atomic<long> redirects_followed = 0;     // Redirect hops taken across all workers
+std::atomic<long> redirects_deduplicated = 0; // Redirects whose target had already been fetched
+std::atomic<long> pages_spilled = 0;          // Pages whose links went to the spill file because of memory pressure
+std::atomic<double> pages_per_second = 0.0;   // Rates over the last monitor interval
+std::atomic<double> bytes_per_second = 0.0;
+std::chrono::steady_clock::time_point crawl_start; // When the workers were launched
+std::atomic<uint64_t> last_page_finished = 0;      // Microseconds after crawl_start that the last page was done
+
+// Result of fetching one URL, after following its redirects.
+struct PageFetch {
+    CURLcode result = CURLE_OK;
+    long response_code = 0;
+    std::string content_type;
+    std::string effective_url;               // Last URL requested (CURLINFO_EFFECTIVE_URL of the final hop)
+    std::vector<std::string> redirect_chain; // Every URL that answered with a redirect, in order
+    bool already_fetched = false;            // A redirect pointed at a URL that is already visited
+    std::string request_headers;             // Raw request header block of the final hop (only with --warc)
+    std::string response_headers;            // Raw response header block of the final hop
+    std::string body;
+};
+
+// A URL a worker has handed to its transport. Redirect hops are submitted one after another, each
+// from the completion of the previous one, and `done` is set once the last hop is in. Kept on the
+// heap: the transport's completions refer to it.
+struct PageInFlight {
+    PageInFlight(std::string start_url, int trace_slot)
+        : url(std::move(start_url)), current(url), host(extract_host(url)), trace_slot(trace_slot) {}
+
+    std::string url;
+    std::string current; // URL of the hop in flight
+    std::string host;
+    PageFetch fetch;
+    int hop = 0;
+    bool done = false;
+    std::chrono::steady_clock::time_point fetch_start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point hop_start;
+    int trace_slot; // In-flight slot whose trace track gets this page's spans (no other page in it holds it)
+    TraceSpan page_span{"page", &url, trace_slot}; // Everything this worker does for the URL
+    TraceSpan fetch_span{"fetch", nullptr, trace_slot};
+};
 
 // --- Function Declarations ---
-size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* userp);
-void search_for_links(GumboNode* node, std::vector<std::string>& links, const std::string& base_url);
-std::string resolve_url(const std::string& base_url, const std::string& relative_url);
+bool same_site(const std::string& host_a, const std::string& host_b);
+std::unique_ptr<Fetcher> make_fetcher();
+void submit_hop(Fetcher& fetcher, PageInFlight& page, StageTimings::Recorder& timings);
+void hop_finished(Fetcher& fetcher, PageInFlight& page, FetchResponse& response, StageTimings::Recorder& timings);
+void record_transfer_times(const TransferTimes& times, StageTimings::Recorder& timings, std::chrono::steady_clock::time_point start, int trace_slot);
+uint64_t micros_since(std::chrono::steady_clock::time_point start);
+bool is_host_failure(CURLcode res);
 void worker_thread_function(int id);
+int rank_main(int argc, char* argv[]);
+int query_main(int argc, char* argv[]);
+int simulate_main(int argc, char* argv[]);
+bool read_config_file(const std::string& path, std::vector<std::string>& args);
+std::string render_metrics();
+bool write_stats_json(const std::string& path);
 
-// --- libcurl Write Callback (remains the same) ---
-size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* userp) {
-    size_t totalSize = size * nmemb;
-    userp->append((char*)contents, totalSize);
-    return totalSize;
+// --- Same-Site Check ---
+// Treats "example.com" and "www.example.com" as the same site, anything else as different.
+bool same_site(const std::string& host_a, const std::string& host_b) {
+    auto strip_www = [](const std::string& host) {
+        return host.rfind("www.", 0) == 0 ? host.substr(4) : host;
+    };
+    return strip_www(host_a) == strip_www(host_b);
 }
 
-// --- Gumbo Parser (Modified to resolve relative URLs) ---
-// We now need the base URL to correctly handle relative links like "/about"
-static void search_for_links(GumboNode* node, std::vector<std::string>& links, const std::string& base_url) {
-    if (node->type != GUMBO_NODE_ELEMENT) return;
-
-    if (node->v.element.tag == GUMBO_TAG_A) {
-        GumboAttribute* href = gumbo_get_attribute(&node->v.element.attributes, "href");
-        if (href && href->value && href->value[0] != '\0') { // Check if href exists and is not empty
-             // NEW: Resolve relative URLs (like "/about") into absolute URLs
-             std::string resolved = resolve_url(base_url, href->value);
-             if (!resolved.empty()) { // Only add valid, resolved URLs
-                links.push_back(resolved);
-             }
-        }
+// --- Transport Selection ---
+// Each worker gets its own Fetcher of the kind chosen with --transport.
+std::unique_ptr<Fetcher> make_fetcher() {
+    bool capture_request_headers = warc_writer != nullptr; // The WARC request record needs them
+    if (transport == "multi") {
+        return std::make_unique<CurlMultiFetcher>(capture_request_headers);
     }
-
-    GumboVector* children = &node->v.element.children;
-    for (unsigned int i = 0; i < children->length; ++i) {
-        search_for_links(static_cast<GumboNode*>(children->data[i]), links, base_url);
+    if (transport == "replay") {
+        return std::make_unique<ReplayFetcher>(*replay_store, replay_latency, replay_latency_ms);
     }
+    if (transport == "mock") {
+        return std::make_unique<MockFetcher>(mock_pages, 10, mock_latency_ms);
+    }
+    return std::make_unique<CurlEasyFetcher>(capture_request_headers);
+}
+
+// --- Redirect-Aware Fetch ---
+// Transports never follow redirects, because that would hide the intermediate hops from us. So
+// redirects are followed here one at a time. Every hop target is marked visited, which makes
+// http://x/a and https://x/a/ collapse into a single fetch, and a hop that lands on an
+// already-visited URL stops before that body is downloaded a second time.
+// The hops run asynchronously, so a worker can have several pages in flight on one transport.
+void submit_hop(Fetcher& fetcher, PageInFlight& page, StageTimings::Recorder& timings) {
+    page.fetch.effective_url = page.current;
+    page.hop_start = std::chrono::steady_clock::now();
+    fetcher.submit({page.current}, [&fetcher, &page, &timings](FetchResponse& response) {
+        hop_finished(fetcher, page, response, timings);
+    });
 }
 
-// --- NEW: URL Resolution Helper ---
-// Basic function to convert relative URLs to absolute URLs
-// A robust crawler needs a much more complex version of this!
-std::string resolve_url(const std::string& base_url, const std::string& relative_url) {
-    // Very basic checks - skip javascript, mailto, anchors, etc.
-    if (relative_url.rfind("javascript:", 0) == 0 ||
-        relative_url.rfind("mailto:", 0) == 0 ||
-        relative_url.find('#') != std::string::npos) {
-        return ""; // Ignore these types of links
+void hop_finished(Fetcher& fetcher, PageInFlight& page, FetchResponse& response, StageTimings::Recorder& timings) {
+    PageFetch& fetch = page.fetch;
+    fetch.result = response.error;
+    if (fetch.result != CURLE_OK) {
+        if (url_statuses) {
+            url_statuses->record(page.current, -static_cast<int>(fetch.result));
+        }
+        crawl_stats.record_error(static_cast<int>(fetch.result));
+        page.done = true;
+        return;
     }
+    long hop_ms = static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - page.hop_start).count());
 
-    // If it's already an absolute URL
-    if (relative_url.rfind("http://", 0) == 0 || relative_url.rfind("https://", 0) == 0) {
-        return relative_url;
+    fetch.effective_url = response.url;
+    fetch.response_code = response.status;
+    fetch.content_type = std::move(response.content_type);
+    fetch.request_headers = std::move(response.request_headers);
+    fetch.response_headers = std::move(response.response_headers);
+    fetch.body = std::move(response.body);
+    record_transfer_times(response.times, timings, page.hop_start, page.trace_slot);
+    crawl_stats.record_response(fetch.response_code, fetch.response_headers.size() + fetch.body.size());
+    if (url_statuses) {
+        url_statuses->record(fetch.effective_url, static_cast<int>(fetch.response_code));
     }
 
-    // If it starts with "//" (protocol-relative)
-    if (relative_url.rfind("//", 0) == 0) {
-        // Find protocol of base URL
-        size_t proto_end = base_url.find(':');
-        if (proto_end != std::string::npos) {
-            return base_url.substr(0, proto_end + 1) + relative_url;
+    bool is_redirect = fetch.response_code >= 300 && fetch.response_code < 400 && !response.location.empty();
+
+    if (warc_writer) {
+        // Every hop is archived, so the redirect chain can be reconstructed from the WARC
+        std::vector<std::pair<std::string, std::string>> metadata = {{"fetchTimeMs", std::to_string(hop_ms)}};
+        if (!fetch.redirect_chain.empty()) {
+            metadata.emplace_back("via", fetch.redirect_chain.back());
         }
-        return ""; // Cannot determine protocol
+        warc_writer->write_exchange(fetch.effective_url, fetch.request_headers,
+                                    fetch.response_headers, fetch.body, metadata);
+    }
+
+    if (!is_redirect || page.hop >= MAX_REDIRECTS) {
+        page.done = true;
+        return;
     }
 
-    // If it starts with "/" (relative to root)
-    if (relative_url.rfind("/", 0) == 0) {
-        // Find the end of the domain part of the base URL
-        // Example: https://www.example.com/some/path -> https://www.example.com
-        size_t protocol_pos = base_url.find("//");
-        if (protocol_pos == std::string::npos) {
-             return ""; // Invalid base URL?
+    fetch.redirect_chain.push_back(fetch.effective_url);
+    redirects_followed++;
+    page.current = response.location;
+    if (!visited_urls.insert(page.current)) {
+        // Someone already fetched (or is fetching) the target: no need to download it again
+        fetch.effective_url = page.current;
+        fetch.already_fetched = true;
+        redirects_deduplicated++;
+        page.done = true;
+        return;
+    }
+    page.hop++;
+    submit_hop(fetcher, page, timings);
+}
+
+// --- Circuit Breaker Helper ---
+// Only failures that say "this host is unreachable or too slow" count towards opening the breaker.
+// Anything that produced an HTTP response (even a 5xx) means the host is alive.
+bool is_host_failure(CURLcode res) {
+    return res == CURLE_COULDNT_RESOLVE_HOST ||
+           res == CURLE_COULDNT_CONNECT ||
+           res == CURLE_OPERATION_TIMEDOUT;
+}
+
+// Splits a transport's cumulative transfer timings into per-phase durations and records them
+// (and, when tracing, as spans laid out from `start`, the moment the transfer began, on the track
+// of in-flight slot `trace_slot`).
+void record_transfer_times(const TransferTimes& times, StageTimings::Recorder& timings, std::chrono::steady_clock::time_point start, int trace_slot) {
+    int64_t dns = times.dns, connect = times.connect, tls = times.tls; // Microseconds since the transfer started
+    int64_t first_byte = times.first_byte, total = times.total;
+
+    timings.record(Stage::Dns, dns);
+    timings.record(Stage::Connect, std::max<int64_t>(0, connect - dns));
+    int64_t ready = connect;
+    if (tls > 0) { // Zero for plain HTTP
+        timings.record(Stage::Tls, std::max<int64_t>(0, tls - connect));
+        ready = tls;
+    }
+    timings.record(Stage::Ttfb, std::max<int64_t>(0, first_byte - ready));
+    timings.record(Stage::Total, total);
+
+    if (TraceBuffer* trace = Tracer::current()) {
+        uint64_t t0 = trace->to_trace_time(start);
+        if (connect > 0) { // In-process transports have no connection phases
+            trace->add("dns", t0, dns, nullptr, trace_slot);
+            trace->add("connect", t0 + dns, std::max<int64_t>(0, connect - dns), nullptr, trace_slot);
         }
-        size_t domain_end = base_url.find('/', protocol_pos + 2);
-        if (domain_end != std::string::npos) {
-            return base_url.substr(0, domain_end) + relative_url;
-        } else {
-            // Base URL might just be the domain (e.g., https://example.com)
-            return base_url + relative_url;
+        if (tls > 0) {
+            trace->add("tls", t0 + connect, std::max<int64_t>(0, tls - connect), nullptr, trace_slot);
         }
+        trace->add("ttfb", t0 + ready, std::max<int64_t>(0, first_byte - ready), nullptr, trace_slot);
+        trace->add("download", t0 + first_byte, std::max<int64_t>(0, total - first_byte), nullptr, trace_slot);
     }
+}
 
-    // Otherwise, it's relative to the current path (e.g., "otherpage.html")
-    size_t last_slash = base_url.rfind('/');
-    // Make sure it's after the protocol part "https://" (index > 7)
-    if (last_slash != std::string::npos && last_slash > 7) {
-        return base_url.substr(0, last_slash + 1) + relative_url;
-    } else {
-         // Base URL might not have a path (e.g., https://example.com)
-        return base_url + "/" + relative_url;
-    }
-     // A production crawler needs a proper URL parsing library (like Boost.URL) for robust handling!
+// Microseconds elapsed since `start`.
+uint64_t micros_since(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
 }
 
 // --- NEW: Worker Thread Function ---
 void worker_thread_function(int id) {
-    std::cout << "Worker [" << id << "] started." << std::endl;
-    CURL* curl_handle = curl_easy_init(); // Each thread needs its own curl handle
-    if (!curl_handle) {
-        std::cerr << "Worker [" << id << "] failed to initialize curl handle." << std::endl;
+    // Pin before anything else, so this worker's log ring, curl handles, buffers and arenas are
+    // allocated on its NUMA node
+    WorkerPlacement& placement = worker_placements.add(id);
+    bool pin_failed = false;
+    if (cpu_affinity.enabled()) {
+        const LogicalCpu& cpu = cpu_affinity.cpu_for(id);
+        if (pin_current_thread(cpu.cpu)) {
+            placement.pinned_cpu = cpu.cpu;
+            placement.node = cpu.node;
+            placement.local_memory = prefer_local_memory();
+        } else {
+            pin_failed = true;
+        }
+    }
+    logger.register_thread("worker " + std::to_string(id));
+    logger.log(LogLevel::Info, "worker_started");
+    if (pin_failed) {
+        logger.log(LogLevel::Warn, "pin_failed", {{"cpu", std::to_string(cpu_affinity.cpu_for(id).cpu)}});
+    }
+    // Last thing before returning: give back the log ring and the ID, and have the monitor join us
+    auto leave_pool = [id]() {
+        logger.release_thread();
+        worker_slots.release(id); // The next worker started takes over this ID, and with it the CPU
+        std::lock_guard<std::mutex> lock(exited_mut);
+        exited_workers.push_back(std::this_thread::get_id());
+    };
+    std::unique_ptr<Fetcher> fetcher; // Each thread needs its own transport (curl handles are per thread)
+    try {
+        fetcher = make_fetcher();
+    } catch (const std::exception& e) {
+        logger.log(LogLevel::Error, "fetcher_init_failed", {{"transport", transport}, {"error", e.what()}});
+        leave_pool();
         return;
     }
-     // Set common curl options once
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl_handle, CURLOPT_FOLLOWLOCATION, 1L); // Follow redirects
-    curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, "MySimpleCrawler/1.0"); // Be polite, identify crawler
-    curl_easy_setopt(curl_handle, CURLOPT_CAINFO, "cacert.pem"); // Path to CA cert bundle
-    curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, 1L); // Verify the server's SSL certificate
-    curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 2L); // Verify the certificate's name against host
-    // Set timeouts to prevent threads from getting stuck indefinitely
-    curl_easy_setopt(curl_handle, CURLOPT_CONNECTTIMEOUT, 10L); // 10 seconds to connect
-    curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT, 20L); // 20 seconds for the entire transfer
 
+    // This worker's private share of the link graph (flushed into link_graph when it fills up or we exit)
+    std::unique_ptr<LinkGraph::Buffer> graph_buffer;
+    if (link_graph) {
+        graph_buffer = std::make_unique<LinkGraph::Buffer>(*link_graph);
+    }
+    // Likewise for the full-text index: postings stay thread-local until the buffer is handed off
+    std::unique_ptr<IndexWriter::Buffer> index_buffer;
+    if (page_index) {
+        index_buffer = std::make_unique<IndexWriter::Buffer>(*page_index);
+    }
+    MemoryAccount& index_account = memory_budget.account(MemoryComponent::IndexBuffers);
+    // Resolved links are built in this arena and reset after each page; only enqueued URLs are copied out
+    Arena link_arena;
+    std::vector<std::string_view> links; // Views into link_arena, reused from page to page
+    std::vector<std::string> graph_links; // The same links as the frontier sees them, for graph_buffer
+    // Gumbo trees are built in this arena too, and dropped in one go instead of node by node
+    Arena parse_arena(PARSE_ARENA_BLOCK, PARSE_ARENA_RETAIN);
+    const GumboOptions parse_options = gumbo_arena_options(parse_arena);
+
+    StageTimings::Recorder& timings = stage_timings.register_thread(); // This thread's histograms
+    if (tracer) {
+        tracer->register_thread("worker " + std::to_string(id)); // Spans below go to this thread's ring
+    }
 
-    while (true) {
-        std::optional<std::string> maybe_url = url_queue.pop(); // Wait for a URL
+    // Pages handed to the transport and not yet processed. The blocking easy transport gets one at a
+    // time; the others overlap up to --inflight transfers per worker
+    std::vector<std::unique_ptr<PageInFlight>> in_flight;
+    const size_t max_in_flight = transport == "easy" ? 1 : static_cast<size_t>(inflight_per_worker);
+    bool retiring = false; // Takes no new URLs, and leaves once in_flight has drained
+    bool stopping = false; // The queue was shut down
 
-        // Check if we should stop (pop returns nullopt if stop requested & queue empty)
-        if (!maybe_url) {
-             //std::cout << "Worker [" << id << "] received stop signal or queue empty." << std::endl;
-            break; // Exit the loop
+    live_workers++;
+    while (true) {
+        // The pool is shrinking: the first workers to get here leave (between pages, never holding a URL)
+        int retire = retiring ? 0 : retire_requests.load();
+        while (retire > 0 && !retire_requests.compare_exchange_weak(retire, retire - 1)) {}
+        if (retire > 0) {
+            logger.log(LogLevel::Debug, "worker_retired");
+            retiring = true;
         }
 
-        std::string url = *maybe_url;
+        // --- Keep the transport busy: wait for a URL only while nothing is in flight ---
+        while (!retiring && !stopping && in_flight.size() < max_in_flight) {
+            // Demoted (suspected trap) URLs are only crawled once the regular frontier has run dry. The
+            // worker that finds it dry moves one per worker over, which also wakes the idle ones
+            if (url_queue.empty()) {
+                for (int i = live_workers.load(); i > 0; --i) {
+                    std::optional<std::string> demoted = demoted_queue.try_pop();
+                    if (!demoted) break;
+                    url_queue.push(std::move(*demoted));
+                }
+            }
+
+            auto wait_start = std::chrono::steady_clock::now();
+            std::optional<std::string> maybe_url;
+            if (in_flight.empty()) {
+                TraceSpan wait_span("queue_wait");
+                maybe_url = url_queue.pop(); // Wait for a URL
+                // Check if we should stop (pop returns nullopt if stop requested & queue empty)
+                if (!maybe_url) {
+                    stopping = true;
+                    break;
+                }
+            } else if (!(maybe_url = url_queue.try_pop())) {
+                break; // Go back to the pages in flight
+            }
+            timings.record(Stage::QueueWait, micros_since(wait_start));
+
+            // --- Critical Section: Check Visited Set ---
+            // Insert returns true only if the url was NOT already present
+            TraceSpan visited_span("visited_check");
+            bool first_visit = visited_urls.insert(*maybe_url);
+            visited_span.end();
+            if (!first_visit) {
+                continue; // Already visited, grab the next URL
+            }
+            // --- End Critical Section ---
 
-        // --- Critical Section: Check Visited Set ---
-        // Insert returns true only if the url was NOT already present
-        if (!visited_urls.insert(url)) {
-            //std::cout << "Worker [" << id << "] skipping already visited: " << url << std::endl;
-            continue; // Already visited, grab the next URL
+            // --- Circuit Breaker: don't spend a worker on a host that keeps timing out ---
+            int trace_slot = 1; // The lowest slot none of the pages in flight holds
+            while (std::any_of(in_flight.begin(), in_flight.end(),
+                               [trace_slot](const std::unique_ptr<PageInFlight>& other) { return other->trace_slot == trace_slot; })) {
+                trace_slot++;
+            }
+            auto page = std::make_unique<PageInFlight>(std::move(*maybe_url), trace_slot);
+            if (!host_breaker.admit(page->host, page->url)) {
+                visited_urls.erase(page->url); // Parked, not fetched: allow it through again once released
+                continue;
+            }
+
+            if (in_flight.empty()) {
+                active_workers++; // This worker has work again (atomic, safe)
+            }
+            crawl_stats.fetch_started(page->host);
+            auto submit_start = std::chrono::steady_clock::now();
+            submit_hop(*fetcher, *page, timings); // Fetch, following redirects by hand
+            fetch_micros += micros_since(submit_start); // The easy transport does the whole transfer here
+            in_flight.push_back(std::move(page));
         }
-        // --- End Critical Section ---
 
-        active_workers++; // Increment active worker count (atomic, safe)
-        //std::cout << "Worker [" << id << "] fetching: " << url << " (Visited: " << visited_urls.size() << ")" << std::endl;
+        // --- Next page whose fetch is complete, running the transport until there is one ---
+        auto next = std::find_if(in_flight.begin(), in_flight.end(),
+                                 [](const std::unique_ptr<PageInFlight>& page) { return page->done; });
+        if (next == in_flight.end()) {
+            if (in_flight.empty()) {
+                if (retiring || stopping) break; // Exit the loop
+                continue;
+            }
+            auto poll_start = std::chrono::steady_clock::now();
+            fetcher->poll(TRANSPORT_POLL_MS);
+            fetch_micros += micros_since(poll_start);
+            continue;
+        }
+        std::unique_ptr<PageInFlight> page = std::move(*next);
+        in_flight.erase(next);
+        page->fetch_span.end();
+        const std::string& url = page->url;
+        const std::string& host = page->host;
+        PageFetch& fetch = page->fetch;
 
-        std::string readBuffer; // Buffer specific to this request in this thread
-        curl_easy_setopt(curl_handle, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, &readBuffer); // Point to this thread's buffer
+        // The response is held until this page is done with
+        MemoryCharge response_charge(memory_budget.account(MemoryComponent::Responses),
+                                     static_cast<int64_t>(fetch.body.capacity() + fetch.response_headers.capacity() +
+                                                          fetch.request_headers.capacity()));
+        crawl_stats.fetch_finished(host);
+        CURLcode res = fetch.result;
 
-        CURLcode res = curl_easy_perform(curl_handle); // Perform the fetch
+        // Charge failures to the host that actually failed (may differ from `host` after a redirect)
+        std::string fetched_host = extract_host(fetch.effective_url);
+        if (is_host_failure(res)) {
+            host_breaker.record_failure(fetched_host, url, std::chrono::steady_clock::now() - page->fetch_start);
+        } else {
+            // Host answered: close its breaker and put any parked URLs back into the queue
+            for (const std::string& parked : host_breaker.record_success(fetched_host, url)) {
+                url_queue.push(parked);
+            }
+        }
+        if (fetched_host != host && !fetch.redirect_chain.empty()) {
+            // The original host answered with a redirect, so it is alive as well
+            for (const std::string& parked : host_breaker.record_success(host, url)) {
+                url_queue.push(parked);
+            }
+        }
 
-        if (res == CURLE_OK) {
-            long response_code;
-            curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &response_code);
+        if (graph_buffer && res == CURLE_OK) {
+            // Redirects are edges too: each hop points at the next one
+            for (size_t i = 0; i < fetch.redirect_chain.size(); ++i) {
+                const std::string& next = i + 1 < fetch.redirect_chain.size() ? fetch.redirect_chain[i + 1] : fetch.effective_url;
+                graph_buffer->add_page(fetch.redirect_chain[i], std::vector<std::string>{next});
+            }
+        }
 
+        if (res == CURLE_OK && !fetch.already_fetched) {
             // Only parse if the response was successful (HTTP 2xx)
-             if (response_code >= 200 && response_code < 300) {
-                 // Check if the content type is HTML before parsing
-                 char *ct = nullptr;
-                 res = curl_easy_getinfo(curl_handle, CURLINFO_CONTENT_TYPE, &ct);
+             if (fetch.response_code >= 200 && fetch.response_code < 300) {
                  // Check if content type exists and contains "text/html"
-                 if (res == CURLE_OK && ct && std::string(ct).find("text/html") != std::string::npos) {
+                 bool is_html = fetch.content_type.find("text/html") != std::string::npos;
 
-                    GumboOutput* output = gumbo_parse(readBuffer.c_str()); // Parse HTML
+                 // Identical body under another URL (session IDs, print views, tracking parameters):
+                 // its links were already extracted, so skip parsing entirely
+                 uint64_t body_hash = is_html ? content_hash(fetch.body) : 0;
+                 if (is_html) {
+                     trap_detector.observe(fetch.effective_url, body_hash); // Learn content-neutral parameters
+                 }
+                 if (is_html && content_fingerprints.check_and_insert(fetched_host, body_hash)) {
+                     logger.log(LogLevel::Debug, "duplicate_content", {{"url", url}});
+                 } else if (is_html) {
+
+                    auto parse_start = std::chrono::steady_clock::now();
+                    TraceSpan parse_span("parse");
+                    parse_arena.reset();
+                    GumboOutput* output = gumbo_parse_with_options(&parse_options, fetch.body.data(), fetch.body.size()); // Parse HTML
+                    // Held while the tree is, up to the parse_arena.reset() below, so the enqueue step's
+                    // pressure check does not count a tree that is already gone
+                    std::optional<MemoryCharge> tree_charge;
+                    tree_charge.emplace(memory_budget.account(MemoryComponent::ParseTrees),
+                                        static_cast<int64_t>(parse_arena.bytes_used()));
+                    parse_span.end();
+                    timings.record(Stage::Parse, micros_since(parse_start));
                     if (output && output->root) {
-                        std::vector<std::string> links;
-                        search_for_links(output->root, links, url); // Extract links, pass base URL
-                        gumbo_destroy_output(&kGumboDefaultOptions, output); // Free Gumbo memory
+                        // Near-duplicate of a page we already crawled (differs only in a timestamp,
+                        // an ad slot, ...): its outlinks are almost certainly already queued.
+                        // Pages with next to no text (link lists, frames) are never judged this way
+                        auto dedup_start = std::chrono::steady_clock::now();
+                        TraceSpan dedup_span("dedup");
+                        std::string text;
+                        extract_visible_text(output->root, text);
+                        std::optional<uint64_t> fingerprint = page_simhash(text);
+                        bool near_duplicate = fingerprint && near_duplicate_index.find_or_insert(*fingerprint);
+                        dedup_span.end();
+                        timings.record(Stage::Dedup, micros_since(dedup_start));
+                        if (index_buffer) {
+                            auto index_start = std::chrono::steady_clock::now();
+                            TraceSpan index_span("index");
+                            size_t buffered_before = index_buffer->buffered_bytes();
+                            index_buffer->add_document(fetch.effective_url, text);
+                            if (memory_budget.pressure() != MemoryBudget::Pressure::Normal &&
+                                index_buffer->buffered_bytes() >= INDEX_FLUSH_UNDER_PRESSURE) {
+                                index_buffer->flush(); // Hand the postings off early rather than let them grow
+                            }
+                            index_account.add(static_cast<int64_t>(index_buffer->buffered_bytes()) -
+                                              static_cast<int64_t>(buffered_before));
+                            index_span.end();
+                            timings.record(Stage::Index, micros_since(index_start));
+                        }
+
+                        links.clear();
+                        link_arena.reset();
+                        if (near_duplicate) {
+                            near_duplicates++;
+                        } else {
+                            auto extract_start = std::chrono::steady_clock::now();
+                            TraceSpan extract_span("extract");
+                            // Relative links are relative to where we ended up, or to <base href> if the page sets one
+                            std::string base_url = fetch.effective_url;
+                            std::string base_href = find_base_href(output->root);
+                            if (!base_href.empty()) {
+                                std::string resolved_base = resolve_url(base_url, base_href);
+                                if (!resolved_base.empty()) {
+                                    base_url = resolved_base;
+                                }
+                            }
+                            search_for_links(output->root, link_arena, links, base_url); // Extract links, pass base URL
+                            extract_span.end();
+                            timings.record(Stage::Extract, micros_since(extract_start));
+                        }
+                        parse_arena.reset(); // Free Gumbo memory (the links live in link_arena)
+                        tree_charge.reset();
 
                         // --- Add newly found links to the queue ---
+                        // Basic check: Only crawl URLs from the same domain (simplistic!)
+                        // The domain is taken from the final URL, so an http -> https or
+                        // example.com -> www.example.com redirect keeps the crawl going, while a
+                        // redirect that leaves the site (e.g. to a login provider) is not followed.
+                        // This needs a proper URL parsing library for robustness
+                        std::string domain;
+                        if (same_site(extract_host(url), fetched_host)) {
+                            size_t start_domain_pos = fetch.effective_url.find("//") + 2;
+                            size_t end_domain_pos = fetch.effective_url.find('/', start_domain_pos);
+                            domain = fetch.effective_url.substr(0, end_domain_pos);
+                        }
+
                         int added = 0;
-                        for (const std::string& link : links) {
-                             // Basic check: Only crawl URLs from the same domain (simplistic!)
-                             // Extract domain from start_url (passed implicitly for now)
-                             // This needs a proper URL parsing library for robustness
-                             // Example: if start_url is https://www.iitk.ac.in/path/
-                             // We only want links starting with https://www.iitk.ac.in
-                             size_t start_domain_pos = url.find("//") + 2;
-                             size_t end_domain_pos = url.find('/', start_domain_pos);
-                             std::string domain = url.substr(0, end_domain_pos);
-
-                             if (link.rfind(domain, 0) == 0) { // Check if link starts with the same domain
-                                url_queue.push(link); // Add to shared queue (thread-safe)
-                                added++;
+                        TraceSpan enqueue_span("enqueue");
+                        // Backpressure: the frontier must not grow, so new links wait on disk instead
+                        bool spill_links = frontier_spill && memory_budget.pressure() != MemoryBudget::Pressure::Normal;
+                        std::vector<std::string> spilled_links;
+                        graph_links.clear();
+                        for (std::string_view candidate : links) {
+                             if (!domain.empty() && candidate.rfind(domain, 0) == 0) { // Check if link starts with the same domain
+                                std::string link(candidate); // Leaves the arena: the frontier keeps it
+                                // Screen for crawler traps; this may also strip session/tracking parameters
+                                TrapDetector::Verdict verdict = trap_detector.check(link);
+                                if (graph_buffer) {
+                                    graph_links.push_back(link); // Canonical, so its node is the one the crawl visits
+                                }
+                                if (verdict == TrapDetector::Verdict::Accept) {
+                                    if (!spill_links) {
+                                        url_queue.push(std::move(link)); // Add to shared queue (thread-safe)
+                                    } else if (!visited_urls.contains(link)) {
+                                        spilled_links.push_back(std::move(link)); // Already crawled ones need no disk space
+                                    }
+                                    added++;
+                                } else if (verdict == TrapDetector::Verdict::Demote) {
+                                    demoted_queue.push(std::move(link));
+                                }
+                             } else if (graph_buffer) {
+                                graph_links.emplace_back(candidate);
                              }
                         }
-                         //std::cout << "Worker [" << id << "] parsed " << links.size() << " links, added " << added << " from: " << url << std::endl;
+                        if (spill_links && !spilled_links.empty()) {
+                            if (frontier_spill->append(spilled_links)) {
+                                pages_spilled++;
+                            } else {
+                                logger.log(LogLevel::Error, "spill_failed", {{"url", fetch.effective_url}});
+                                for (std::string& link : spilled_links) {
+                                    url_queue.push(std::move(link)); // Over budget beats losing them
+                                }
+                            }
+                        }
+                        enqueue_span.end();
+                        if (graph_buffer) {
+                            graph_buffer->add_page(fetch.effective_url, graph_links); // Thread-local until the buffer fills
+                        }
+                         //std::cout << "Worker [" << id << "] parsed " << links.size() << " links, added " << added << " from: " << fetch.effective_url << std::endl;
                     } else {
-                         std::cerr << "Worker [" << id << "] Gumbo failed to parse: " << url << std::endl;
+                         logger.log(LogLevel::Warn, "parse_failed", {{"url", url}});
                     }
                  } else {
-                     //std::cout << "Worker [" << id << "] skipping non-HTML content (" << (ct ? ct : "N/A") << "): " << url << std::endl;
+                     //std::cout << "Worker [" << id << "] skipping non-HTML content (" << fetch.content_type << "): " << url << std::endl;
                  }
              } else {
-                  //std::cerr << "Worker [" << id << "] received non-2xx status code (" << response_code << ") for: " << url << std::endl;
+                  //std::cerr << "Worker [" << id << "] received non-2xx status code (" << fetch.response_code << ") for: " << url << std::endl;
              }
+        } else if (res == CURLE_OK) {
+            logger.log(LogLevel::Debug, "redirect_deduplicated", {{"url", url}, {"target", fetch.effective_url}});
         } else {
             // Log curl errors, but continue working
-            std::cerr << "Worker [" << id << "] curl_easy_perform() failed for " << url << ": " << curl_easy_strerror(res) << std::endl;
+            logger.log(LogLevel::Warn, "fetch_failed", {{"url", fetch.effective_url}, {"error", curl_easy_strerror(res)}});
+        }
+        last_page_finished = micros_since(crawl_start);
+        placement.page_done();
+        if (in_flight.empty()) {
+            active_workers--; // Idle until the next URL (atomic, safe)
         }
-        active_workers--; // Decrement active worker count (atomic, safe)
     } // End of while loop
 
-    curl_easy_cleanup(curl_handle); // Clean up this thread's curl handle
-    std::cout << "Worker [" << id << "] finished." << std::endl;
+    graph_buffer.reset(); // Hand the remaining edges to the shared graph
+    if (index_buffer) {
+        index_account.sub(static_cast<int64_t>(index_buffer->buffered_bytes()));
+    }
+    index_buffer.reset(); // And the remaining postings to the index's segment thread
+    fetcher.reset(); // Clean up this thread's transport (and its curl handles)
+    live_workers--;
+    logger.log(LogLevel::Info, "worker_finished");
+
+    // Hand this thread's trace buffer and histograms to the next worker the pool starts
+    stage_timings.release_thread(timings);
+    if (tracer) {
+        tracer->release_thread();
+    }
+    leave_pool();
+}
+
+// --- Metrics endpoint ---
+// Everything here is read from atomics or from locks the workers barely touch (breaker, in-flight
+// map, histogram registry); the frontier and visited-set locks are never taken by a scrape.
+std::string render_metrics() {
+    MetricsText m;
+    m.counter("crawler_responses_total", "HTTP responses received, redirect hops included", crawl_stats.response_count());
+    m.counter("crawler_bytes_downloaded_total", "Response header and body bytes received", crawl_stats.bytes_downloaded());
+    m.gauge("crawler_pages_per_second", "Newly visited URLs per second over the last monitor interval", pages_per_second.load());
+    m.gauge("crawler_bytes_per_second", "Bytes downloaded per second over the last monitor interval", bytes_per_second.load());
+    m.gauge("crawler_queue_depth", "URLs waiting in the frontier", url_queue.approx_size());
+    m.gauge("crawler_demoted_queue_depth", "Suspected trap URLs held back", demoted_queue.approx_size());
+    m.gauge("crawler_visited_urls", "URLs in the visited set", visited_urls.approx_size());
+    m.gauge("crawler_active_workers", "Workers currently fetching or parsing", active_workers.load());
+    m.gauge("crawler_worker_threads", "Worker threads running", live_workers.load());
+    uint64_t migrations = 0;
+    worker_placements.for_each([&](const WorkerPlacement& placement) { migrations += placement.migrations.load(); });
+    m.counter("crawler_worker_migrations_total", "Pages a worker finished on another CPU than its previous page", migrations);
+    m.gauge("crawler_tripped_hosts", "Hosts whose circuit breaker is open", host_breaker.tripped_count());
+    for (const auto& [host, count] : crawl_stats.hosts_in_flight()) {
+        m.gauge("crawler_host_in_flight", "Fetches in progress per host", count, "{host=\"" + MetricsText::escape(host) + "\"}");
+    }
+    static const char* const classes[] = {"other", "1xx", "2xx", "3xx", "4xx", "5xx"};
+    for (size_t c = 0; c < 6; ++c) {
+        m.counter("crawler_http_responses_total", "HTTP responses by status class", crawl_stats.status_class_count(c),
+                  std::string("{class=\"") + classes[c] + "\"}");
+    }
+    for (int code = 0; code < CrawlStats::MAX_ERROR_CODE; ++code) {
+        if (uint64_t count = crawl_stats.error_count(code)) {
+            m.counter("crawler_fetch_errors_total", "Failed transfers by curl error", count,
+                      "{type=\"" + MetricsText::escape(curl_easy_strerror(static_cast<CURLcode>(code))) + "\"}");
+        }
+    }
+    m.counter("crawler_redirects_total", "Redirect hops followed", redirects_followed.load());
+    for (size_t c = 0; c < MEMORY_COMPONENT_COUNT; ++c) {
+        MemoryComponent component = static_cast<MemoryComponent>(c);
+        m.gauge("crawler_memory_bytes", "Estimated memory held per component", memory_budget.account(component).used(),
+                std::string("{component=\"") + memory_component_name(component) + "\"}");
+    }
+    m.gauge("crawler_memory_budget_bytes", "Memory budget (0: none)", memory_budget.limit_bytes());
+    m.gauge("crawler_frontier_spilled_urls", "Frontier URLs waiting on disk", frontier_spill ? frontier_spill->pending() : 0);
+    m.counter("crawler_pages_spilled_total", "Pages whose links went to the spill file under memory pressure", pages_spilled.load());
+    m.counter("crawler_near_duplicates_total", "Pages whose outlinks were skipped as near-duplicates", near_duplicates.load());
+    static const std::vector<double> bounds = {0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30};
+    for (size_t s = 0; s < STAGE_COUNT; ++s) {
+        m.histogram("crawler_stage_seconds", "Time spent per stage of a page", stage_timings.merged(static_cast<Stage>(s)),
+                    bounds, std::string("stage=\"") + stage_name(static_cast<Stage>(s)) + "\"");
+    }
+    return m.str();
+}
+
+// --- Run summary for crawler_bench ---
+// Rates use the time until the last page was finished, not until the monitor noticed the crawl
+// was over, so they do not depend on where the crawl ended within a monitor interval.
+bool write_stats_json(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) return false;
+    double elapsed = last_page_finished.load() / 1e6;
+    uint64_t errors = 0;
+    for (int code = 0; code < CrawlStats::MAX_ERROR_CODE; ++code) {
+        errors += crawl_stats.error_count(code);
+    }
+    LatencyHistogram total = stage_timings.merged(Stage::Total);
+    out << "{\n  \"elapsed_seconds\": " << elapsed
+        << ",\n  \"threads\": " << worker_target.load()
+        << ",\n  \"transport\": \"" << transport << "\""
+        << ",\n  \"pages\": " << visited_urls.size()
+        << ",\n  \"responses\": " << crawl_stats.response_count()
+        << ",\n  \"bytes\": " << crawl_stats.bytes_downloaded()
+        << ",\n  \"errors\": " << errors
+        << ",\n  \"http_5xx\": " << crawl_stats.status_class_count(5)
+        << ",\n  \"redirects\": " << redirects_followed.load()
+        << ",\n  \"pages_per_second\": " << (elapsed > 0 ? visited_urls.size() / elapsed : 0.0)
+        << ",\n  \"bytes_per_second\": " << (elapsed > 0 ? crawl_stats.bytes_downloaded() / elapsed : 0.0)
+        << ",\n  \"latency_p50_ms\": " << total.percentile(50) / 1000.0
+        << ",\n  \"latency_p99_ms\": " << total.percentile(99) / 1000.0
+        << ",\n  \"pages_spilled\": " << pages_spilled.load()
+        << ",\n  \"frontier_spilled\": " << (frontier_spill ? frontier_spill->spilled_total() : 0)
+        << ",\n  \"affinity\": \"" << cpu_affinity.policy_name() << "\""
+        << ",\n  \"stages\": {";
+    for (size_t s = 0; s < STAGE_COUNT; ++s) {
+        LatencyHistogram h = stage_timings.merged(static_cast<Stage>(s));
+        out << (s ? "," : "") << "\n    \"" << stage_name(static_cast<Stage>(s)) << "\": {\"count\": " << h.count()
+            << ", \"mean_ms\": " << h.mean() / 1000.0 << ", \"p50_ms\": " << h.percentile(50) / 1000.0
+            << ", \"p99_ms\": " << h.percentile(99) / 1000.0 << "}";
+    }
+    out << "\n  },\n  \"memory\": {";
+    for (size_t c = 0; c < MEMORY_COMPONENT_COUNT; ++c) {
+        MemoryComponent component = static_cast<MemoryComponent>(c);
+        out << (c ? "," : "") << "\n    \"" << memory_component_name(component) << "\": {\"bytes\": "
+            << memory_budget.account(component).used() << ", \"peak_bytes\": " << memory_budget.account(component).peak_used() << "}";
+    }
+    out << "\n  },\n  \"placement\": [";
+    bool first = true;
+    worker_placements.for_each([&](const WorkerPlacement& placement) {
+        out << (first ? "" : ",") << "\n    {\"worker\": " << placement.worker << ", \"cpu\": " << placement.pinned_cpu
+            << ", \"node\": " << placement.node << ", \"local_memory\": " << (placement.local_memory ? "true" : "false")
+            << ", \"last_cpu\": " << placement.last_cpu.load() << ", \"pages\": " << placement.pages.load()
+            << ", \"migrations\": " << placement.migrations.load() << "}";
+        first = false;
+    });
+    out << "\n  ]\n}\n";
+    return static_cast<bool>(out);
+}
+
+// --- Config file ---
+// One "key = value" per line, where key is a command-line option without its dashes
+// ("threads = auto", "warc = crawl"); "url = ..." gives the start URL. Blank lines and lines
+// starting with '#' are skipped. Appends the equivalent command-line arguments to `args`.
+bool read_config_file(const std::string& path, std::vector<std::string>& args) {
+    std::ifstream in(path);
+    if (!in) return false;
+    auto trim = [](const std::string& text) {
+        size_t begin = text.find_first_not_of(" \t\r");
+        size_t end = text.find_last_not_of(" \t\r");
+        return begin == std::string::npos ? std::string() : text.substr(begin, end - begin + 1);
+    };
+    for (std::string line; std::getline(in, line); ) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#') continue;
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            std::cerr << path << ": expected \"key = value\": " << line << std::endl;
+            return false;
+        }
+        std::string key = trim(line.substr(0, equals));
+        std::string value = trim(line.substr(equals + 1));
+        if (key != "url") {
+            args.push_back("--" + key);
+        }
+        args.push_back(value);
+    }
+    return true;
+}
+
+// --- "crawler rank": PageRank over a link graph written with --graph ---
+// Writes <prefix>.scores: one "url<TAB>score" line per node, highest score first.
+// That file can seed the next crawl with --seeds.
+int rank_main(int argc, char* argv[]) {
+    std::string prefix;
+    std::string out_path;
+    PageRankOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--damping" && i + 1 < argc) {
+            options.damping = std::stod(argv[++i]);
+        } else if (arg == "--tolerance" && i + 1 < argc) {
+            options.tolerance = std::stod(argv[++i]);
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            options.max_iterations = std::stoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--out" && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (arg.rfind("--", 0) != 0 && prefix.empty()) {
+            prefix = arg;
+        } else {
+            prefix.clear();
+            break;
+        }
+    }
+    if (prefix.empty()) {
+        std::cerr << "Usage: " << argv[0] << " <graph prefix> [--damping 0.85] [--tolerance 1e-6]"
+                  << " [--iterations 100] [--threads N] [--out <file>]" << std::endl;
+        return 1;
+    }
+    if (out_path.empty()) {
+        out_path = prefix + ".scores";
+    }
+
+    try {
+        auto start = std::chrono::steady_clock::now();
+        LinkGraphView graph(prefix + ".graph");
+        PageRank pagerank(graph, options.threads);
+        double load_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Loaded " << graph.num_nodes() << " nodes, " << pagerank.edge_count() << " edges in "
+                  << load_seconds << "s" << std::endl;
+
+        start = std::chrono::steady_clock::now();
+        PageRankResult result = pagerank.run(options);
+        double rank_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "PageRank: " << result.iterations << " iterations, final delta " << result.delta
+                  << ", " << rank_seconds << "s (" << options.threads << " threads)" << std::endl;
+
+        // --- Write scores, best first ---
+        std::ifstream urls_in(prefix + ".urls");
+        std::vector<std::string> urls;
+        for (std::string line; std::getline(urls_in, line); ) {
+            urls.push_back(line);
+        }
+        if (urls.size() != result.scores.size()) {
+            std::cerr << prefix << ".urls does not match " << prefix << ".graph" << std::endl;
+            return 1;
+        }
+        std::vector<uint32_t> order(urls.size());
+        for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(),
+                  [&](uint32_t a, uint32_t b) { return result.scores[a] > result.scores[b]; });
+        std::ofstream out(out_path);
+        out.precision(10);
+        for (uint32_t node : order) {
+            out << urls[node] << '\t' << result.scores[node] << '\n';
+        }
+        std::cout << "Scores written to " << out_path << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "rank: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// --- "crawler query": search an index written with --index ---
+// Full-text queries run against the segment files; --url looks the URL up in urls.tbl.
+// Both are mmap'd in place, so nothing is loaded up front.
+int query_main(int argc, char* argv[]) {
+    std::string dir;
+    std::string query;
+    std::string lookup_url;
+    size_t limit = 20;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--url" && i + 1 < argc) {
+            lookup_url = argv[++i];
+        } else if (arg == "--limit" && i + 1 < argc) {
+            limit = std::stoul(argv[++i]);
+        } else if (arg.rfind("--", 0) != 0 && dir.empty()) {
+            dir = arg;
+        } else if (arg.rfind("--", 0) != 0 && query.empty()) {
+            query = arg;
+        } else {
+            dir.clear();
+            break;
+        }
+    }
+    if (dir.empty() || query.empty() == lookup_url.empty()) {
+        std::cerr << "Usage: " << argv[0] << " <index dir> <query> [--limit 20]" << std::endl;
+        std::cerr << "       " << argv[0] << " <index dir> --url <URL>" << std::endl;
+        std::cerr << "Query syntax: terms are ANDed; \"quoted phrase\", -excluded, a OR b" << std::endl;
+        return 1;
+    }
+
+    try {
+        auto start = std::chrono::steady_clock::now();
+        if (!lookup_url.empty()) {
+            UrlStatusView table((std::filesystem::path(dir) / "urls.tbl").string());
+            const UrlTableEntry* entry = table.find(lookup_url);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (!entry) {
+                std::cout << lookup_url << ": not fetched (" << ms << " ms)" << std::endl;
+                return 2;
+            }
+            if (entry->status < 0) {
+                std::cout << lookup_url << ": failed, " << curl_easy_strerror(static_cast<CURLcode>(-entry->status));
+            } else {
+                std::cout << lookup_url << ": HTTP " << entry->status;
+            }
+            std::cout << " (" << ms << " ms)" << std::endl;
+            return 0;
+        }
+
+        IndexSearcher searcher(dir);
+        std::vector<std::string> urls = searcher.search(query);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        for (size_t i = 0; i < urls.size() && i < limit; ++i) {
+            std::cout << urls[i] << std::endl;
+        }
+        std::cout << urls.size() << " of " << searcher.document_count() << " documents match ("
+                  << searcher.segment_count() << " segments, " << ms << " ms)" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "query: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// --- "crawler simulate": discrete-event simulation of a crawl ---
+// Runs the frontier and dedup set against a modeled web and network on a virtual clock, to try
+// scheduler and politeness settings at scales (millions of URLs) a live crawl cannot reach quickly.
+int simulate_main(int argc, char* argv[]) {
+    SimulationOptions options;
+    std::string json_path;
+    bool valid = true;
+    for (int i = 1; i < argc && valid; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            valid = false;
+        } else if (arg == "--seed") {
+            options.seed = std::stoull(argv[++i]);
+        } else if (arg == "--hosts") {
+            options.hosts = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--pages-per-host") {
+            options.pages_per_host = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--links") {
+            options.links_per_page = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--cross-host") {
+            options.cross_host_links = std::stod(argv[++i]);
+        } else if (arg == "--rtt-ms") {
+            options.rtt_ms = std::stod(argv[++i]);
+        } else if (arg == "--bandwidth-kb") {
+            options.bandwidth_kb = std::stod(argv[++i]);
+        } else if (arg == "--page-kb") {
+            options.page_kb = std::stod(argv[++i]);
+        } else if (arg == "--host-slots") {
+            options.host_slots = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--workers") {
+            options.workers = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--parse-us-per-kb") {
+            options.parse_us_per_kb = std::stod(argv[++i]);
+        } else if (arg == "--max-pages") {
+            options.max_pages = std::stoull(argv[++i]);
+        } else if (arg == "--politeness-ms") {
+            options.politeness_ms = std::stod(argv[++i]);
+        } else if (arg == "--polite-interval-ms") {
+            options.polite_interval_ms = std::stod(argv[++i]);
+        } else if (arg == "--json") {
+            json_path = argv[++i];
+        } else {
+            valid = false;
+        }
+    }
+    if (!valid || options.hosts == 0 || options.workers == 0 || options.host_slots == 0) {
+        std::cerr << "Usage: " << argv[0] << " [--seed 1] [--hosts 1000] [--pages-per-host 1000] [--links 10]"
+                  << " [--cross-host 0.05]" << std::endl;
+        std::cerr << "       [--rtt-ms 50] [--bandwidth-kb 1000] [--page-kb 32] [--host-slots 4]"
+                  << " [--workers 4] [--parse-us-per-kb 20]" << std::endl;
+        std::cerr << "       [--max-pages N] [--politeness-ms 0] [--polite-interval-ms 1000] [--json <file>]" << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    CrawlSimulator simulator(options);
+    SimulationResult result = simulator.run();
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("--- Simulated Crawl (seed %llu) ---\n", static_cast<unsigned long long>(options.seed));
+    std::printf("  pages           %12llu  (%u of %u hosts)\n", static_cast<unsigned long long>(result.pages),
+                result.hosts_crawled, options.hosts);
+    std::printf("  simulated time  %12.1f s\n", result.simulated_seconds());
+    std::printf("  pages/s         %12.1f  (simulated)\n", result.pages_per_second());
+    std::printf("  MB/s            %12.2f  (simulated)\n",
+                result.simulated_micros ? result.bytes / (1024.0 * 1024.0) / result.simulated_seconds() : 0.0);
+    std::printf("  fetch p50       %12.1f ms\n", result.fetch_latency.percentile(50) / 1000.0);
+    std::printf("  fetch p99       %12.1f ms\n", result.fetch_latency.percentile(99) / 1000.0);
+    std::printf("  links           %12llu  (%llu duplicates)\n", static_cast<unsigned long long>(result.links_seen),
+                static_cast<unsigned long long>(result.duplicate_links));
+    std::printf("  frontier peak   %12zu\n", result.frontier_peak);
+    std::printf("--- Politeness (interval %.0f ms, policy %.0f ms) ---\n", options.polite_interval_ms, options.politeness_ms);
+    std::printf("  violations      %12llu  (%u hosts)\n", static_cast<unsigned long long>(result.politeness_violations),
+                result.hosts_violated);
+    std::printf("  max per host    %12u  concurrent requests\n", result.max_host_concurrency);
+    std::printf("  held back       %12llu  URLs\n", static_cast<unsigned long long>(result.parked));
+    std::printf("Simulated %llu events in %.2f s wall (%.0f events/s)\n", static_cast<unsigned long long>(result.events),
+                wall, wall > 0 ? result.events / wall : 0.0);
+
+    if (!json_path.empty()) {
+        std::ofstream out(json_path);
+        out << "{\n  \"seed\": " << options.seed
+            << ",\n  \"pages\": " << result.pages
+            << ",\n  \"bytes\": " << result.bytes
+            << ",\n  \"simulated_seconds\": " << result.simulated_seconds()
+            << ",\n  \"pages_per_second\": " << result.pages_per_second()
+            << ",\n  \"fetch_p50_ms\": " << result.fetch_latency.percentile(50) / 1000.0
+            << ",\n  \"fetch_p99_ms\": " << result.fetch_latency.percentile(99) / 1000.0
+            << ",\n  \"frontier_peak\": " << result.frontier_peak
+            << ",\n  \"politeness_violations\": " << result.politeness_violations
+            << ",\n  \"hosts_violated\": " << result.hosts_violated
+            << ",\n  \"max_host_concurrency\": " << result.max_host_concurrency
+            << ",\n  \"wall_seconds\": " << wall << "\n}\n";
+        if (!out) {
+            std::cerr << "Cannot write " << json_path << std::endl;
+            return 1;
+        }
+    }
+    return 0;
 }
 
 // --- Main function (rewritten for multi-threading) ---
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <Start URL>" << std::endl;
+    // --- Subcommands ---
+    if (argc >= 2 && std::string(argv[1]) == "rank") {
+        return rank_main(argc - 1, argv + 1);
+    }
+    if (argc > 1 && std::string(argv[1]) == "query") {
+        return query_main(argc - 1, argv + 1);
+    }
+    if (argc > 1 && std::string(argv[1]) == "simulate") {
+        return simulate_main(argc - 1, argv + 1);
+    }
+
+    // --- Parse command line ---
+    std::string start_url;
+    std::string warc_prefix;       // --warc: write WARC files named <prefix>-00000.warc.gz, ...
+    size_t warc_max_mb = 1024;     // --warc-max-mb: rotate WARC files after this many megabytes
+    std::string graph_prefix;      // --graph: write the link graph to <prefix>.graph and <prefix>.urls
+    std::string seeds_path;        // --seeds: score file from "crawler rank" to prioritize the frontier
+    size_t seed_limit = 10000;     // --seed-limit: how many of the best-scored URLs to seed
+    size_t trap_demote_after = 200;     // --trap-demote-after: demote a trap-shaped URL pattern past this many URLs
+    size_t trap_max_per_pattern = 1000; // --trap-max-per-pattern: ... and reject it past this many
+    std::string index_dir;         // --index: write full-text index segments into this directory
+    int metrics_port = 0;          // --metrics-port: serve Prometheus metrics on 127.0.0.1:<port>
+    std::string metrics_socket;    // --metrics-socket: ... or on this Unix domain socket
+    std::string trace_path;        // --trace: write a Chrome trace of every worker's spans to this file
+    std::string stats_path;        // --stats-json: write a run summary (rates, latency percentiles) here
+    std::string replay_path;       // --replay: crawl a WARC file/prefix or a mirror directory instead of the network
+    std::string log_path;          // --log: worker log (NDJSON) goes here instead of stderr
+    size_t memory_budget_mb = 0;   // --memory-budget-mb: apply backpressure, then spill the frontier, near this
+    std::string spill_dir;         // --spill-dir: where the spilled frontier goes (default: the temp directory)
+    std::string affinity_spec;     // --affinity: compact, scatter or a CPU list
+    LogLevel log_level = LogLevel::Info; // --log-level: debug, info, warn, error or off
+
+    // --config <file>: its settings go in front of the command line, so command-line options win
+    std::vector<std::string> config_args;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--config") {
+            if (!read_config_file(argv[i + 1], config_args)) {
+                std::cerr << "Cannot read config file " << argv[i + 1] << std::endl;
+                return 1;
+            }
+        }
+    }
+    std::vector<char*> all_args = {argv[0]};
+    for (std::string& config_arg : config_args) all_args.push_back(config_arg.data());
+    all_args.insert(all_args.end(), argv + 1, argv + argc);
+    argc = static_cast<int>(all_args.size());
+    argv = all_args.data();
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--config" && i + 1 < argc) {
+            ++i; // Already read
+        } else if (arg == "--threads" && i + 1 < argc) {
+            std::string count = argv[++i];
+            auto_threads = count == "auto";
+            if (!auto_threads) {
+                num_threads = std::atoi(count.c_str());
+                if (num_threads < 1) {
+                    start_url.clear();
+                    break;
+                }
+            }
+        } else if (arg == "--memory-budget-mb" && i + 1 < argc) {
+            memory_budget_mb = std::stoul(argv[++i]);
+        } else if (arg == "--spill-dir" && i + 1 < argc) {
+            spill_dir = argv[++i];
+        } else if (arg == "--max-threads" && i + 1 < argc) {
+            max_threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--affinity" && i + 1 < argc) {
+            affinity_spec = argv[++i];
+        } else if (arg == "--warc" && i + 1 < argc) {
+            warc_prefix = argv[++i];
+        } else if (arg == "--warc-max-mb" && i + 1 < argc) {
+            warc_max_mb = std::stoul(argv[++i]);
+        } else if (arg == "--graph" && i + 1 < argc) {
+            graph_prefix = argv[++i];
+        } else if (arg == "--log" && i + 1 < argc) {
+            log_path = argv[++i];
+        } else if (arg == "--log-level" && i + 1 < argc) {
+            std::string name = argv[++i];
+            LogLevel levels[] = {LogLevel::Debug, LogLevel::Info, LogLevel::Warn, LogLevel::Error, LogLevel::Off};
+            bool known = false;
+            for (LogLevel level : levels) {
+                if (name == log_level_name(level)) {
+                    log_level = level;
+                    known = true;
+                }
+            }
+            if (!known) {
+                start_url.clear();
+                break;
+            }
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (arg == "--stats-json" && i + 1 < argc) {
+            stats_path = argv[++i];
+        } else if (arg == "--transport" && i + 1 < argc) {
+            transport = argv[++i];
+            if (transport != "easy" && transport != "multi" && transport != "replay" && transport != "mock") {
+                start_url.clear();
+                break;
+            }
+        } else if (arg == "--mock-pages" && i + 1 < argc) {
+            mock_pages = std::stoull(argv[++i]);
+        } else if (arg == "--mock-latency-ms" && i + 1 < argc) {
+            mock_latency_ms = std::stoi(argv[++i]);
+        } else if (arg == "--inflight" && i + 1 < argc) {
+            inflight_per_worker = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replay_path = argv[++i];
+            transport = "replay";
+        } else if (arg == "--replay-latency" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "zero") {
+                replay_latency = ReplayLatency::Zero;
+            } else if (mode == "recorded") {
+                replay_latency = ReplayLatency::Recorded;
+            } else if (!mode.empty() && std::all_of(mode.begin(), mode.end(), ::isdigit)) {
+                replay_latency = ReplayLatency::Synthetic;
+                replay_latency_ms = std::stoi(mode);
+            } else {
+                start_url.clear();
+                break;
+            }
+        } else if (arg == "--metrics-port" && i + 1 < argc) {
+            metrics_port = std::stoi(argv[++i]);
+        } else if (arg == "--metrics-socket" && i + 1 < argc) {
+            metrics_socket = argv[++i];
+        } else if (arg == "--index" && i + 1 < argc) {
+            index_dir = argv[++i];
+        } else if (arg == "--seeds" && i + 1 < argc) {
+            seeds_path = argv[++i];
+        } else if (arg == "--seed-limit" && i + 1 < argc) {
+            seed_limit = std::stoul(argv[++i]);
+        } else if (arg == "--trap-demote-after" && i + 1 < argc) {
+            trap_demote_after = std::stoul(argv[++i]);
+        } else if (arg == "--trap-max-per-pattern" && i + 1 < argc) {
+            trap_max_per_pattern = std::stoul(argv[++i]);
+        } else if (arg.rfind("--", 0) != 0 && start_url.empty()) {
+            start_url = arg;
+        } else {
+            start_url.clear();
+            break;
+        }
+    }
+    if (start_url.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [options] <Start URL>" << std::endl;
+        std::cerr << "Options:" << std::endl;
+        std::cerr << "  --config <file>      Read options from <file> (\"threads = auto\" lines); the command line wins" << std::endl;
+        std::cerr << "  --threads <n|auto>   Worker threads, or auto-tune the count while crawling (default 4)" << std::endl;
+        std::cerr << "  --max-threads <n>    Upper bound for --threads auto (default 256)" << std::endl;
+        std::cerr << "  --affinity <policy>  Pin workers: compact, scatter or a CPU list such as 0-7,16-23" << std::endl;
+        std::cerr << "  --memory-budget-mb <n> Stop extracting links near n MB, and spill the frontier to disk" << std::endl;
+        std::cerr << "  --spill-dir <dir>    Directory for the spilled frontier (default: the temp directory)" << std::endl;
+        std::cerr << "  --trap-demote-after <n>    Demote a trap-shaped URL pattern after n URLs (default 200)" << std::endl;
+        std::cerr << "  --trap-max-per-pattern <n> Reject a trap-shaped URL pattern after n URLs (default 1000)" << std::endl;
+        std::cerr << "  --warc <prefix>      Archive every response to <prefix>-NNNNN.warc.gz" << std::endl;
+        std::cerr << "  --warc-max-mb <n>    Start a new WARC file after n megabytes (default 1024)" << std::endl;
+        std::cerr << "  --graph <prefix>     Write the link graph to <prefix>.graph (CSR) and <prefix>.urls" << std::endl;
+        std::cerr << "  --index <dir>        Build a full-text index of the crawled pages in <dir>" << std::endl;
+        std::cerr << "  --log <file>         Write the worker log (NDJSON) to <file> instead of stderr" << std::endl;
+        std::cerr << "  --log-level <level>  debug, info, warn, error or off (default info)" << std::endl;
+        std::cerr << "  --trace <file>       Write a Chrome/Perfetto trace of the last spans of every worker" << std::endl;
+        std::cerr << "  --transport <t>      easy, multi (curl), replay or mock (in-process site) (default easy)" << std::endl;
+        std::cerr << "  --mock-pages <n>     Size of the mock transport's site (default 100000)" << std::endl;
+        std::cerr << "  --mock-latency-ms <n> Delay of every mock response (default 0)" << std::endl;
+        std::cerr << "  --inflight <n>       Transfers each worker overlaps on the multi, replay and mock transports (default 8)" << std::endl;
+        std::cerr << "  --replay <path>      Crawl recorded responses (WARC file, --warc prefix or mirror directory) offline" << std::endl;
+        std::cerr << "  --replay-latency <m> zero, recorded (WARC fetch times) or a mean in ms (default zero)" << std::endl;
+        std::cerr << "  --stats-json <file>  Write a run summary (pages/s, bytes/s, latency percentiles) as JSON" << std::endl;
+        std::cerr << "  --metrics-port <n>   Serve Prometheus metrics on 127.0.0.1:<n> instead of the monitor line" << std::endl;
+        std::cerr << "  --metrics-socket <p> Serve Prometheus metrics on the Unix socket <p>" << std::endl;
+        std::cerr << "  --seeds <file>       Seed the queue with the best URLs from a 'crawler rank' score file" << std::endl;
+        std::cerr << "  --seed-limit <n>     Number of seed URLs to take from --seeds (default 10000)" << std::endl;
+        std::cerr << "Other modes:" << std::endl;
+        std::cerr << "  " << argv[0] << " rank <graph prefix> [options]   Compute PageRank over a --graph output" << std::endl;
+        std::cerr << "  " << argv[0] << " query <index dir> <query> | --url <URL>   Search an --index output" << std::endl;
+        std::cerr << "  " << argv[0] << " simulate [options]   Simulate a crawl on a virtual clock (scheduler/politeness)" << std::endl;
+        return 1;
+    }
+
+    trap_detector.set_pattern_limits(trap_demote_after, std::max(trap_demote_after, trap_max_per_pattern));
+
+    // --- Memory accounting (always on; the limit only with --memory-budget-mb) ---
+    url_queue.track_memory(&memory_budget.account(MemoryComponent::Frontier));
+    demoted_queue.track_memory(&memory_budget.account(MemoryComponent::Frontier));
+    visited_urls.track_memory(&memory_budget.account(MemoryComponent::Visited));
+    trap_detector.track_memory(&memory_budget.account(MemoryComponent::Visited)); // Its per-URL fingerprints
+    if (memory_budget_mb > 0) {
+        memory_budget.set_limit(static_cast<uint64_t>(memory_budget_mb) << 20);
+        std::filesystem::path dir = spill_dir.empty() ? std::filesystem::temp_directory_path()
+                                                      : std::filesystem::path(spill_dir);
+        std::string name = "crawler-frontier-" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count()) + ".spill";
+        try {
+            frontier_spill = std::make_unique<FrontierSpill>((dir / name).string());
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if (!warc_prefix.empty()) {
+        try {
+            warc_writer = std::make_unique<WarcWriter>(warc_prefix, warc_max_mb << 20);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+    if (!graph_prefix.empty()) {
+        link_graph = std::make_unique<LinkGraph>();
+    }
+    if (!index_dir.empty()) {
+        // An existing index is extended: its segments stay, and its URL table is carried over
+        try {
+            page_index = std::make_unique<IndexWriter>(index_dir);
+            url_statuses = std::make_unique<UrlStatusTable>();
+            std::filesystem::path url_table = std::filesystem::path(index_dir) / "urls.tbl";
+            if (std::filesystem::exists(url_table)) {
+                url_statuses->load(UrlStatusView(url_table.string()));
+            }
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        if (page_index->live_segments() > 0) {
+            std::cout << "Extending the index in " << index_dir << " (" << page_index->live_segments()
+                      << " existing segment(s))" << std::endl;
+        }
+    }
+    if (!trace_path.empty()) {
+        tracer = std::make_unique<Tracer>();
+    }
+    if (!affinity_spec.empty()) {
+        std::optional<CpuAffinity> affinity = CpuAffinity::parse(affinity_spec, detect_cpus());
+        if (!affinity) {
+            std::cerr << "--affinity must be compact, scatter or a list of CPUs this process may use (e.g. 0-3,8), not "
+                      << affinity_spec << std::endl;
+            return 1;
+        }
+        cpu_affinity = *affinity;
+    }
+    if (transport == "replay" && replay_path.empty()) {
+        std::cerr << "--transport replay needs --replay <path>" << std::endl;
         return 1;
     }
-    std::string start_url = argv[1];
+    if (!replay_path.empty()) {
+        try {
+            replay_store = std::make_unique<ReplayStore>(replay_path);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << "Replaying " << replay_store->size() << " recorded responses ("
+                  << replay_store->body_bytes() / (1024.0 * 1024.0) << " MB) from " << replay_path << std::endl;
+    }
+    std::FILE* log_file = stderr;
+    if (!log_path.empty()) {
+        log_file = std::fopen(log_path.c_str(), "ab");
+        if (!log_file) {
+            std::cerr << "Cannot open log file " << log_path << std::endl;
+            return 1;
+        }
+    }
+    logger.start(log_file, log_level);
 
     // --- Initialize curl globally ---
     // Needs to be called once per program run
     curl_global_init(CURL_GLOBAL_ALL);
 
+    // --- Metrics endpoint (replaces the monitor line) ---
+    std::unique_ptr<MetricsServer> metrics_server;
+    if (metrics_port > 0 || !metrics_socket.empty()) {
+        try {
+            metrics_server = std::make_unique<MetricsServer>(metrics_port, metrics_socket, render_metrics);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << "Serving metrics on "
+                  << (metrics_socket.empty() ? "http://127.0.0.1:" + std::to_string(metrics_port) + "/metrics" : metrics_socket)
+                  << std::endl;
+    }
+
     // Add the starting URL to the queue
     url_queue.push(start_url);
 
+    // Then the best-ranked URLs of a previous crawl, highest score first, so they are fetched early.
+    // They pass the same screening as discovered links: on the start URL's site, and not a trap.
+    if (!seeds_path.empty()) {
+        std::ifstream seeds(seeds_path);
+        std::string start_host = extract_host(start_url);
+        size_t seeded = 0, demoted = 0, off_site = 0, traps = 0;
+        for (std::string line; seeded < seed_limit && std::getline(seeds, line); ) {
+            std::string seed_url = line.substr(0, line.find('\t'));
+            if (seed_url.empty()) continue;
+            if (!same_site(extract_host(seed_url), start_host)) {
+                off_site++;
+                continue;
+            }
+            TrapDetector::Verdict verdict = trap_detector.check(seed_url);
+            if (verdict == TrapDetector::Verdict::Accept) {
+                url_queue.push(std::move(seed_url));
+                seeded++;
+            } else if (verdict == TrapDetector::Verdict::Demote) {
+                demoted_queue.push(std::move(seed_url));
+                demoted++;
+            } else {
+                traps++;
+            }
+        }
+        std::cout << "Seeded " << seeded << " URLs from " << seeds_path << " (" << demoted << " demoted; rejected "
+                  << off_site << " off-site, " << traps << " traps)" << std::endl;
+    }
+
     // --- Create and launch worker threads ---
     std::vector<std::thread> workers;
-    std::cout << "Launching " << NUM_THREADS << " worker threads..." << std::endl;
-    for (int i = 0; i < NUM_THREADS; ++i) {
-        // Create a thread and run worker_thread_function with its ID
-        workers.emplace_back(worker_thread_function, i);
+    crawl_start = std::chrono::steady_clock::now();
+    // --threads auto starts where a fixed count would, or at one worker per core if that is more
+    if (auto_threads) {
+        num_threads = std::min(max_threads, std::max<int>(num_threads, std::thread::hardware_concurrency()));
     }
+    ConcurrencyTuner tuner(num_threads, 1, max_threads);
+    // Grows or shrinks the pool to `target` workers. Growing first cancels pending retirements.
+    auto resize_pool = [&](int target) {
+        int delta = target - worker_target.exchange(target);
+        for (; delta > 0; --delta) {
+            int pending = retire_requests.load();
+            while (pending > 0 && !retire_requests.compare_exchange_weak(pending, pending - 1)) {}
+            if (pending == 0) {
+                // Create a thread and run worker_thread_function with its ID
+                workers.emplace_back(worker_thread_function, worker_slots.acquire());
+            }
+        }
+        if (delta < 0) {
+            retire_requests += -delta;
+        }
+    };
+    std::cout << "Launching " << num_threads << " worker threads (" << transport << " transport"
+              << (auto_threads ? ", auto-tuned" : "") << ")..." << std::endl;
+    resize_pool(num_threads);
+    double last_cpu_seconds = process_cpu_seconds();
+    uint64_t last_fetch_micros = 0;
+
+    auto last_tick = std::chrono::steady_clock::now();
+    size_t last_visited = 0;
+    size_t last_warc_bytes = 0;
+    uint64_t last_bytes = 0;
+    bool warc_failure_logged = false;
 
     // --- Main loop to monitor progress and decide when to stop ---
     // This simple logic stops when the queue is empty AND no workers are busy.
@@ -244,15 +1395,139 @@ int main(int argc, char* argv[]) {
         // Sleep for a short duration to avoid busy-waiting in the main thread
         std::this_thread::sleep_for(std::chrono::seconds(2));
 
+        // Workers that retired since the last tick are done: join them now rather than at shutdown
+        {
+            std::vector<std::thread::id> exited;
+            {
+                std::lock_guard<std::mutex> lock(exited_mut);
+                exited.swap(exited_workers);
+            }
+            for (std::thread::id exited_id : exited) {
+                auto it = std::find_if(workers.begin(), workers.end(),
+                                       [exited_id](const std::thread& worker) { return worker.get_id() == exited_id; });
+                if (it != workers.end()) {
+                    it->join();
+                    workers.erase(it);
+                }
+            }
+        }
+
+        // Hosts whose breaker cooldown expired get one half-open probe URL back in the queue
+        for (const std::string& probe : host_breaker.release_probes()) {
+            url_queue.push(probe);
+        }
+
+        // Workers move demoted URLs over themselves; this only matters if every worker went idle
+        // waiting for URLs before the last ones were demoted
+        if (url_queue.empty()) {
+            for (int i = 0; i < DEMOTED_BATCH; ++i) {
+                std::optional<std::string> demoted = demoted_queue.try_pop();
+                if (!demoted) break;
+                url_queue.push(*demoted);
+            }
+        }
+
+        // --- Memory pressure: spill the frontier to disk, or read it back once there is room ---
+        MemoryBudget::Pressure pressure = memory_budget.pressure();
+        if (frontier_spill) {
+            if (pressure == MemoryBudget::Pressure::Spill && url_queue.approx_size() > SPILL_KEEP) {
+                // Keep the oldest URLs in memory so the workers stay busy; the rest wait on disk
+                std::vector<std::string> kept;
+                std::vector<std::string> spilled;
+                while (std::optional<std::string> queued = url_queue.try_pop()) {
+                    (kept.size() < SPILL_KEEP ? kept : spilled).push_back(std::move(*queued));
+                }
+                for (std::string& url : kept) {
+                    url_queue.push(std::move(url));
+                }
+                if (frontier_spill->append(spilled)) {
+                    std::cout << "Memory: " << memory_budget.used() / (1024.0 * 1024.0) << " MB, spilled "
+                              << spilled.size() << " frontier URLs to disk" << std::endl;
+                } else {
+                    logger.log(LogLevel::Error, "spill_failed", {{"urls", std::to_string(spilled.size())}});
+                    for (std::string& url : spilled) {
+                        url_queue.push(std::move(url)); // Over budget beats losing them
+                    }
+                }
+            } else if (frontier_spill->pending() > 0 && url_queue.approx_size() < SPILL_KEEP &&
+                       (pressure != MemoryBudget::Pressure::Spill || url_queue.empty())) {
+                // Refill even under pressure once the queue is empty: the crawl must keep moving
+                for (std::string& url : frontier_spill->read(SPILL_KEEP)) {
+                    url_queue.push(std::move(url));
+                }
+            }
+        }
+
         bool is_queue_empty = url_queue.empty(); // Check if queue is empty (thread-safe check)
+        bool spill_pending = frontier_spill && frontier_spill->pending() > 0;
         int current_active = active_workers.load(); // Read atomic counter (thread-safe)
+        bool breaker_pending = host_breaker.has_pending(); // Parked URLs still waiting for a probe
+
+        // Crawl rate (and archive write rate) over the last monitoring interval
+        size_t visited_now = visited_urls.size();
+        size_t warc_bytes_now = warc_writer ? warc_writer->bytes_written() : 0;
+        double interval = std::chrono::duration<double>(std::chrono::steady_clock::now() - last_tick).count();
+        uint64_t bytes_now = crawl_stats.bytes_downloaded();
+        double pages_per_sec = (static_cast<double>(visited_now) - static_cast<double>(last_visited)) / interval;
+        double warc_mb_per_sec = (warc_bytes_now - last_warc_bytes) / interval / (1024.0 * 1024.0);
+        pages_per_second = pages_per_sec;
+        bytes_per_second = (bytes_now - last_bytes) / interval;
+        last_tick = std::chrono::steady_clock::now();
+        last_visited = visited_now;
+        last_warc_bytes = warc_bytes_now;
+        last_bytes = bytes_now;
+
+        // The archive stops on a write error while the crawl goes on: say so once, when it happens
+        if (warc_writer && !warc_failure_logged) {
+            std::string error = warc_writer->error();
+            if (!error.empty()) {
+                logger.log(LogLevel::Error, "warc_failed", {{"error", error}});
+                warc_failure_logged = true;
+            }
+        }
+
+        // --- Auto-tune the worker count ---
+        double cpu_now = process_cpu_seconds();
+        uint64_t fetch_micros_now = fetch_micros.load();
+        if (auto_threads) {
+            TunerSample sample;
+            sample.pages_per_second = pages_per_sec;
+            sample.cpu_utilization = (cpu_now - last_cpu_seconds) / interval /
+                                     std::max(1u, std::thread::hardware_concurrency());
+            sample.io_wait = (fetch_micros_now - last_fetch_micros) / 1e6 / interval / std::max(1, worker_target.load());
+            sample.starved = is_queue_empty && current_active < worker_target.load();
+            int before = worker_target.load();
+            int after = tuner.observe(sample);
+            if (after != before) {
+                resize_pool(after);
+                std::cout << "Auto-tune: " << before << " -> " << after << " workers (" << tuner.reason()
+                          << "; " << pages_per_sec << " pages/s, CPU " << static_cast<int>(sample.cpu_utilization * 100)
+                          << "%, I/O wait " << static_cast<int>(sample.io_wait * 100) << "%)" << std::endl;
+            }
+        }
+        last_cpu_seconds = cpu_now;
+        last_fetch_micros = fetch_micros_now;
 
-        std::cout << "Monitoring: Queue empty? " << (is_queue_empty ? "Yes" : "No")
-                  << ", Active workers: " << current_active
-                  << ", Visited: " << visited_urls.size() << std::endl;
+        if (!metrics_server) { // With a metrics endpoint the numbers are scraped instead
+            std::cout << "Monitoring: Queue empty? " << (is_queue_empty ? "Yes" : "No")
+                      << ", Active workers: " << current_active << "/" << live_workers.load()
+                      << ", Visited: " << visited_now
+                      << ", Pages/s: " << pages_per_sec
+                      << ", Tripped hosts: " << host_breaker.tripped_count()
+                      << ", Memory MB: " << memory_budget.used() / (1024.0 * 1024.0);
+            if (pressure != MemoryBudget::Pressure::Normal || spill_pending) {
+                std::cout << " (" << MemoryBudget::pressure_name(pressure) << ", "
+                          << frontier_spill->pending() << " URLs spilled)";
+            }
+            if (warc_writer) {
+                std::cout << ", WARC MB/s: " << warc_mb_per_sec;
+            }
+            std::cout << std::endl;
+        }
 
         // If the queue is empty AND no threads are currently fetching/parsing, we are done.
-        if (is_queue_empty && current_active == 0) {
+        // Hosts with an open breaker may still hand back URLs, so wait for them too.
+        if (is_queue_empty && current_active == 0 && !breaker_pending && demoted_queue.empty() && !spill_pending) {
             std::cout << "Queue empty and workers idle. Requesting stop..." << std::endl;
             url_queue.request_stop(); // Signal the queue to stop and wake up waiting threads
             break; // Exit the monitoring loop
@@ -267,12 +1542,86 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    logger.stop(); // Drain the workers' last messages
+    if (log_file != stderr) {
+        std::fclose(log_file);
+    }
+
+    if (!stats_path.empty() && !write_stats_json(stats_path)) {
+        std::cerr << "Cannot write " << stats_path << std::endl;
+    }
+
+    // --- Write the trace ---
+    if (tracer) {
+        size_t spans = tracer->write(trace_path);
+        std::cout << "Trace: " << spans << " spans written to " << trace_path << std::endl;
+    }
+
+    // --- Flush the archive ---
+    if (warc_writer) {
+        warc_writer->close(); // Drains the pending batch and closes the current file
+        std::cout << "WARC: " << warc_writer->records_written() << " records, "
+                  << warc_writer->bytes_written() / (1024.0 * 1024.0) << " MB in "
+                  << warc_writer->files_written() << " file(s)" << std::endl;
+        std::string error = warc_writer->error();
+        if (!error.empty()) {
+            std::cerr << "WARC: archiving stopped early: " << error << std::endl;
+        }
+    }
+
+    // --- Write the link graph ---
+    if (link_graph) {
+        auto write_start = std::chrono::steady_clock::now();
+        try {
+            uint64_t edges = link_graph->write(graph_prefix);
+            std::cout << "Link graph: " << link_graph->node_count() << " nodes, " << edges << " edges written to "
+                      << graph_prefix << ".graph in "
+                      << std::chrono::duration<double>(std::chrono::steady_clock::now() - write_start).count() << "s"
+                      << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Link graph not written: " << e.what() << std::endl; // The index and reports still follow
+        }
+    }
+
+    // --- Finish the index ---
+    if (page_index) {
+        page_index->close(); // Writes the last segments and lets a pending merge complete
+        std::cout << "Index: " << page_index->documents() << " documents in " << page_index->live_segments()
+                  << " segment(s) (" << page_index->segments_written() << " written, "
+                  << page_index->merges_done() << " merges) in " << index_dir << std::endl;
+        for (const std::string& error : page_index->errors()) {
+            std::cerr << "Index: " << error << std::endl;
+        }
+        try {
+            uint64_t url_count = url_statuses->write((std::filesystem::path(index_dir) / "urls.tbl").string());
+            std::cout << "URL table: " << url_count << " URLs" << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "URL table not written: " << e.what() << std::endl;
+        }
+    }
+
     // --- Cleanup curl globally ---
     // Needs to be called once after all curl operations are done
     curl_global_cleanup();
 
     std::cout << "\n--- Crawling Finished ---" << std::endl;
     std::cout << "Total unique pages visited: " << visited_urls.size() << std::endl;
+    std::cout << "Redirects followed: " << redirects_followed.load()
+              << " (" << redirects_deduplicated.load() << " led to an already-fetched page)" << std::endl;
+    std::cout << "Near-duplicate pages (outlinks skipped): " << near_duplicates.load() << std::endl;
+    content_fingerprints.report(std::cout);
+    trap_detector.report(std::cout);
+    host_breaker.report(std::cout);
+    stage_timings.report(std::cout);
+    memory_budget.report(std::cout);
+    worker_placements.report(std::cout, cpu_affinity);
+    if (frontier_spill) {
+        std::cout << "  frontier URLs spilled to disk: " << frontier_spill->spilled_total()
+                  << ", pages whose links were spilled under pressure: " << pages_spilled.load() << std::endl;
+    }
+#ifdef CRAWLER_LOCK_PROFILING
+    LockProfiler::instance().report(std::cout);
+#endif
 
     return 0;
 }
@@ -0,0 +1,60 @@
+// Near-duplicate detection on parsed pages: pages without enough text must never be flagged,
+// while real near-duplicates still are.
+#include <optional>
+#include <string>
+#include <gumbo.h>
+
+#include "simhash.hpp"
+#include "page_text.hpp"
+#include "test_check.hpp"
+
+// Visible text of `html`, as the worker extracts it.
+static std::string visible_text(const std::string& html) {
+    GumboOutput* output = gumbo_parse_with_options(&kGumboDefaultOptions, html.data(), html.size());
+    std::string text;
+    extract_visible_text(output->root, text);
+    gumbo_destroy_output(&kGumboDefaultOptions, output);
+    return text;
+}
+
+// A link-only page like synthetic_site serves: a handful of anchors and nothing else.
+static std::string link_page(int page) {
+    std::string html = "<html><head><script>var page = " + std::to_string(page) + ";</script></head><body>";
+    for (int link = 0; link < 6; ++link) {
+        std::string name = "p" + std::to_string(page * 6 + link);
+        html += "<a href=\"/" + name + "\">" + name + "</a> ";
+    }
+    return html + "</body></html>";
+}
+
+static std::string article(const std::string& changed_word) {
+    std::string html = "<html><body><h1>Quarterly report</h1><p>";
+    for (int sentence = 0; sentence < 12; ++sentence) {
+        html += "The committee reviewed item " + std::to_string(sentence) + " of the agenda and approved the budget. ";
+    }
+    return html + "Published on " + changed_word + ".</p></body></html>";
+}
+
+int main() {
+    // Empty and link-only pages: no fingerprint, so none of them can match another
+    SimHashIndex index;
+    CHECK(!page_simhash(visible_text("<html><body></body></html>")));
+    int flagged = 0;
+    for (int page = 0; page < 121; ++page) {
+        std::optional<uint64_t> fingerprint = page_simhash(visible_text(link_page(page)));
+        CHECK(!fingerprint);
+        if (fingerprint && index.find_or_insert(*fingerprint)) flagged++;
+    }
+    CHECK(flagged == 0);
+
+    // Pages with real text still get caught when they differ only in a date
+    std::optional<uint64_t> monday = page_simhash(visible_text(article("Monday")));
+    std::optional<uint64_t> tuesday = page_simhash(visible_text(article("Tuesday")));
+    CHECK(monday && tuesday);
+    if (monday && tuesday) {
+        CHECK(!index.find_or_insert(*monday));
+        CHECK(index.find_or_insert(*tuesday));
+    }
+
+    return test_result("near_duplicate_test");
+}
@@ -0,0 +1,32 @@
+#ifndef TEST_CHECK_HPP
+#define TEST_CHECK_HPP
+
+#include <cstdio>
+
+// The scaffold every test under tests/ shares: CHECK records a failed condition and carries on, so
+// one run reports all of them, and main ends with `return test_result("<test name>");`.
+
+inline int& test_failures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            test_failures()++;                                                  \
+        }                                                                       \
+    } while (0)
+
+// The exit code for main: 1 (after a summary) if any CHECK failed, 0 otherwise.
+inline int test_result(const char* name) {
+    if (test_failures()) {
+        std::fprintf(stderr, "%d check(s) failed\n", test_failures());
+        return 1;
+    }
+    std::printf("%s passed\n", name);
+    return 0;
+}
+
+#endif // TEST_CHECK_HPP
@@ -0,0 +1,83 @@
+// WARC round trip: what WarcWriter archives, ReplayStore must hand back unchanged, and a
+// Transfer-Encoding: chunked header alone must never make it rewrite a body.
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "warc_writer.hpp"
+#include "replay_store.hpp"
+#include "test_check.hpp"
+
+// An uncompressed WARC response record, as another tool might write it.
+static std::string response_record(const std::string& url, const std::string& http) {
+    return "WARC/1.1\r\nWARC-Type: response\r\nWARC-Target-URI: " + url +
+           "\r\nContent-Type: application/http;msgtype=response\r\nContent-Length: " + std::to_string(http.size()) +
+           "\r\n\r\n" + http + "\r\n\r\n";
+}
+
+int main() {
+    namespace fs = std::filesystem;
+    std::string run = std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    fs::path dir = fs::temp_directory_path() / ("warc_replay_test-" + run);
+    fs::create_directories(dir);
+
+    // --- Written by WarcWriter, as a crawl records it ---
+    // curl hands over de-chunked bodies; this one even starts like a chunk-size line
+    const std::string chunked_headers = "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nTransfer-Encoding: chunked\r\n\r\n";
+    const std::string tricky_body = "1f\r\n<html><body><a href=\"/next\">next</a></body></html>";
+    const std::string plain_headers = "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: 5\r\n\r\n";
+    const std::string redirect_headers = "HTTP/1.1 301 Moved Permanently\r\nLocation: /moved\r\nContent-Length: 0\r\n\r\n";
+    std::string prefix = (dir / "crawl").string();
+    {
+        WarcWriter writer(prefix);
+        writer.write_exchange("http://site.test/", "GET / HTTP/1.1\r\nHost: site.test\r\n\r\n", chunked_headers,
+                              tricky_body, {{"fetchTimeMs", "42"}});
+        writer.write_exchange("http://site.test/plain", "", plain_headers, "hello", {});
+        writer.write_exchange("http://site.test/old", "", redirect_headers, "", {{"fetchTimeMs", "7"}});
+        writer.close();
+    }
+    {
+        ReplayStore store(prefix);
+        CHECK(store.size() == 3);
+        const ReplayResponse* page = store.find("http://site.test/");
+        CHECK(page && page->status == 200 && page->body == tricky_body);
+        CHECK(page && page->content_type == "text/html" && page->fetch_ms == 42);
+        CHECK(page && page->headers.find("\r\nTransfer-Encoding:") == std::string::npos);
+        CHECK(page && page->headers.find("Content-Length: " + std::to_string(tricky_body.size()) + "\r\n") != std::string::npos);
+        const ReplayResponse* plain = store.find("https://SITE.test/plain#top");
+        CHECK(plain && plain->status == 200 && plain->body == "hello");
+        const ReplayResponse* moved = store.find("http://site.test/old");
+        CHECK(moved && moved->status == 301 && moved->location == "/moved" && moved->body.empty() && moved->fetch_ms == 7);
+        CHECK(!store.find("http://site.test/missing"));
+    }
+
+    // --- Written by other tools, with the framing kept or not ---
+    std::string foreign = (dir / "foreign.warc").string();
+    {
+        const std::string te = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+        std::ofstream out(foreign, std::ios::binary);
+        out << response_record("http://other.test/framed", te + "5\r\nhello\r\n7;ext=1\r\n, world\r\n0\r\n\r\n")
+            << response_record("http://other.test/trailer", te + "2\r\nok\r\n0\r\nExpires: never\r\n\r\n")
+            << response_record("http://other.test/decoded", te + "<p>already decoded</p>")
+            << response_record("http://other.test/hexlike", te + "abc\r\ndef")
+            << response_record("http://other.test/unterminated", te + "5\r\nhello\r\n")
+            << response_record("http://other.test/short", te + "ff\r\nhello\r\n0\r\n\r\n");
+    }
+    {
+        ReplayStore store(foreign);
+        auto body_of = [&store](const char* url) {
+            const ReplayResponse* response = store.find(url);
+            return response ? response->body : std::string("<missing>");
+        };
+        CHECK(body_of("http://other.test/framed") == "hello, world");
+        CHECK(body_of("http://other.test/trailer") == "ok");
+        CHECK(body_of("http://other.test/decoded") == "<p>already decoded</p>");
+        CHECK(body_of("http://other.test/hexlike") == "abc\r\ndef");
+        CHECK(body_of("http://other.test/unterminated") == "5\r\nhello\r\n");
+        CHECK(body_of("http://other.test/short") == "ff\r\nhello\r\n0\r\n\r\n");
+    }
+
+    fs::remove_all(dir);
+    return test_result("warc_replay_test");
+}